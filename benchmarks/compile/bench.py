@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+#
+# Saphyr, a C++ style compiler using LLVM
+# Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Times saphyr and syfmt over generated corpora and prints the results as JSON.
+
+import os, sys, json, time, shutil, tempfile, argparse, subprocess
+import generate
+
+SAPHYR_BIN = "../../saphyr"
+SYFMT_BIN = "../../syfmt"
+
+# name -> generator options, each stressing one part of the compiler
+CORPORA = {
+	"functions": ["--functions", "2000", "--depth", "2", "--structs", "0", "--classes", "0", "--imports", "0", "--literals", "0"],
+	"nesting": ["--functions", "50", "--depth", "40", "--structs", "0", "--classes", "0", "--imports", "0", "--literals", "0"],
+	"structs": ["--functions", "0", "--structs", "500", "--members", "64", "--classes", "200", "--imports", "0", "--literals", "0"],
+	"imports": ["--functions", "10", "--structs", "0", "--classes", "0", "--imports", "200", "--members", "16", "--literals", "0"],
+	"literals": ["--functions", "0", "--structs", "0", "--classes", "0", "--imports", "0", "--literals", "50", "--literal-size", "65536"],
+	"mixed": []
+}
+
+def countLines(files):
+	lines = 0
+	for file in files:
+		with open(file, "rb") as f:
+			lines += f.read().count(b"\n")
+	return lines
+
+def timed(cmd, cwd):
+	# wait4 gives the peak RSS of this child alone
+	start = time.perf_counter()
+	proc = subprocess.Popen(cmd, cwd=cwd, stdout=subprocess.DEVNULL)
+	_, status, usage = os.wait4(proc.pid, 0)
+	seconds = time.perf_counter() - start
+	if not os.WIFEXITED(status) or os.WEXITSTATUS(status):
+		sys.exit("failed: " + " ".join(cmd))
+	return seconds, usage.ru_maxrss
+
+def runSaphyr(saphyr, main, lexer, extra):
+	out = os.path.join(os.path.dirname(main), "phases.json")
+	cmd = [saphyr, "--lexer", lexer, "--time-phases", out] + extra + [os.path.basename(main)]
+	seconds, rss = timed(cmd, os.path.dirname(main))
+	with open(out) as f:
+		result = json.load(f)
+	result["wallSeconds"] = seconds
+	result["peakRssKB"] = rss
+	return result
+
+def runSyfmt(syfmt, main, lexer):
+	cmd = [syfmt, "--lexer", lexer, os.path.basename(main)]
+	seconds, rss = timed(cmd, os.path.dirname(main))
+	lines = countLines([main])
+	return {"input": os.path.basename(main), "files": 1, "lines": lines, "seconds": seconds,
+		"linesPerSecond": lines / seconds if seconds else 0, "peakRssKB": rss}
+
+def best(runs):
+	return min(runs, key=lambda r: r["seconds"])
+
+def main(argv):
+	parser = argparse.ArgumentParser(description="time saphyr and syfmt over generated corpora")
+	parser.add_argument("corpora", nargs="*", help="corpora to run (default: all of " + ", ".join(CORPORA) + ")")
+	parser.add_argument("-r", "--repeat", type=int, default=3, help="runs of each command, the fastest is reported")
+	parser.add_argument("-o", "--output", help="write the JSON results to the given file instead of stdout")
+	parser.add_argument("--lexer", action="append", help="lexers to run with (default: flex and fast)")
+	parser.add_argument("--optimize", action="store_true", help="also run the optimizer")
+	parser.add_argument("--saphyr", default=SAPHYR_BIN)
+	parser.add_argument("--syfmt", default=SYFMT_BIN)
+	args = parser.parse_args(argv)
+
+	saphyr = os.path.abspath(args.saphyr)
+	syfmt = os.path.abspath(args.syfmt)
+	lexers = args.lexer or ["flex", "fast"]
+	extra = ["--optimize"] if args.optimize else []
+
+	results = []
+	workDir = tempfile.mkdtemp(prefix="saphyr-bench-")
+	try:
+		for name in args.corpora or CORPORA:
+			if name not in CORPORA:
+				sys.exit("unknown corpus: " + name)
+			options = generate.parseArgs([os.path.join(workDir, name)] + CORPORA[name])
+			main = generate.generate(options)
+			for lexer in lexers:
+				compile = best([runSaphyr(saphyr, main, lexer, extra) for i in range(args.repeat)])
+				fmt = best([runSyfmt(syfmt, main, lexer) for i in range(args.repeat)])
+				for tool, result in (("saphyr", compile), ("syfmt", fmt)):
+					result.update({"corpus": name, "tool": tool, "lexer": lexer})
+					results.append(result)
+					print("{:10} {:7} {:5} {:8.3f}s {:12.0f} lines/s {:8} KB".format(name, tool, lexer,
+						result["seconds"], result["linesPerSecond"], result["peakRssKB"]), file=sys.stderr)
+	finally:
+		shutil.rmtree(workDir)
+
+	text = json.dumps(results, indent=2)
+	if args.output:
+		with open(args.output, "w") as f:
+			f.write(text + "\n")
+	else:
+		print(text)
+
+if __name__ == "__main__":
+	main(sys.argv[1:])
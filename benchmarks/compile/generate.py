@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+#
+# Saphyr, a C++ style compiler using LLVM
+# Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Generates a synthetic Saphyr corpus: main.syp plus an import chain.
+
+import os, sys, argparse
+
+TYPES = ["int", "int64", "double", "int8", "uint16", "float"]
+
+def struct(name, members):
+	out = "struct " + name + "\n{\n"
+	for i in range(members):
+		out += "\t" + TYPES[i % len(TYPES)] + " m" + str(i) + ";\n"
+	return out + "}\n\n"
+
+def nested(depth, indent):
+	tab = "\t" * indent
+	if depth == 0:
+		return tab + "x = x * 3 + 1;\n"
+	if depth % 2:
+		return (tab + "if (x > " + str(depth) + ") {\n" + nested(depth - 1, indent + 1)
+			+ tab + "} else {\n" + tab + "\tx += " + str(depth) + ";\n" + tab + "}\n")
+	return (tab + "while (x < " + str(depth * 100) + ") {\n" + nested(depth - 1, indent + 1)
+		+ tab + "}\n")
+
+def function(n, depth, callee):
+	out = "int func" + str(n) + "(int a, int b)\n{\n"
+	out += "\tint x = a * " + str(n) + " + b;\n"
+	out += nested(depth, 1)
+	out += "\treturn x + " + callee + "(b);\n}\n\n"
+	return out
+
+def klass(n):
+	return ("class Class" + str(n) + "\n{\n"
+		"\tstruct this\n\t{\n\t\tint value;\n\t\tdouble scale;\n\t}\n\n"
+		"\tint get(int k)\n\t{\n\t\treturn value + k;\n\t}\n\n"
+		"\tvoid set(int v)\n\t{\n\t\tvalue = v;\n\t\tscale = v * 0.5;\n\t}\n}\n\n")
+
+def literal(n, size):
+	text = ("the quick brown fox \\\"jumps\\\" over the lazy dog\\n " * (size // 50 + 1))[:size]
+	return "auto literal" + str(n) + " = \"" + text.rstrip("\\") + "\";\n\n"
+
+def chainFile(n, count, members):
+	out = ""
+	if n + 1 < count:
+		out += "import \"chain" + str(n + 1) + ".syp\";\n\n"
+	out += struct("Chain" + str(n), members)
+	out += "int chain" + str(n) + "(int x)\n{\n"
+	out += "\treturn x + " + ("chain" + str(n + 1) + "(x)" if n + 1 < count else "1") + ";\n}\n"
+	return out
+
+def mainFile(args):
+	out = ""
+	if args.imports:
+		out += "import \"chain0.syp\";\n\n"
+	for i in range(args.structs):
+		out += struct("Big" + str(i), args.members)
+		out += "Big" + str(i) + " big" + str(i) + ";\n\n"
+	for i in range(args.classes):
+		out += klass(i)
+	for i in range(args.literals):
+		out += literal(i, args.literal_size)
+	callee = "chain0" if args.imports else "leaf"
+	if not args.imports:
+		out += "int leaf(int x)\n{\n\treturn x;\n}\n\n"
+	for i in range(args.functions):
+		out += function(i, args.depth, callee)
+	out += "int main()\n{\n\treturn 0;\n}\n"
+	return out
+
+def parseArgs(argv):
+	parser = argparse.ArgumentParser(description="generate a synthetic Saphyr corpus")
+	parser.add_argument("outdir", help="directory to write main.syp and its imports to")
+	parser.add_argument("--functions", type=int, default=200, help="number of functions")
+	parser.add_argument("--depth", type=int, default=6, help="nesting depth of the statements in each function")
+	parser.add_argument("--structs", type=int, default=10, help="number of structs")
+	parser.add_argument("--members", type=int, default=32, help="members in each struct")
+	parser.add_argument("--classes", type=int, default=20, help="number of classes")
+	parser.add_argument("--imports", type=int, default=5, help="length of the import chain")
+	parser.add_argument("--literals", type=int, default=4, help="number of string literals")
+	parser.add_argument("--literal-size", type=int, default=4096, help="bytes in each string literal")
+	return parser.parse_args(argv)
+
+def generate(args):
+	os.makedirs(args.outdir, exist_ok=True)
+	for i in range(args.imports):
+		with open(os.path.join(args.outdir, "chain" + str(i) + ".syp"), "w") as f:
+			f.write(chainFile(i, args.imports, args.members))
+	main = os.path.join(args.outdir, "main.syp")
+	with open(main, "w") as f:
+		f.write(mainFile(args))
+	return main
+
+if __name__ == "__main__":
+	print(generate(parseArgs(sys.argv[1:])))
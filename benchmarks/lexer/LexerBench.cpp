@@ -0,0 +1,226 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <boost/filesystem.hpp>
+#include "Lexer.h"
+#include "SourceManager.h"
+
+using namespace boost::filesystem;
+
+/**
+ * Measures the throughput of the flexc++ Scanner and the FastLexer
+ * over a set of source files, and checks they produce the same tokens.
+ * With --worst-case it instead generates pathological inputs of doubling
+ * size and fails when the throughput of either lexer isn't linear.
+ *
+ * usage: lexer-bench [-n iterations] file.syp...
+ *        lexer-bench [-n iterations] --worst-case
+ */
+
+struct Result
+{
+	double seconds;
+	size_t tokens;
+};
+
+static size_t lexFile(Lexer::Kind kind, const string& file)
+{
+	auto lexer = Lexer::create(kind, file);
+	ParserBase::STYPE__ val;
+	lexer->setSval(&val);
+
+	// both lexers map the file again on each pass
+	SourceManager::clear();
+
+	size_t count = 0;
+	for (;;) {
+		val.t_tok = nullptr;
+		if (!lexer->lex())
+			return count;
+		delete val.t_tok;
+		count++;
+	}
+}
+
+static Result run(Lexer::Kind kind, const vector<string>& files, int iterations)
+{
+	size_t tokens = 0;
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		for (auto& file : files)
+			tokens += lexFile(kind, file);
+	}
+	chrono::duration<double> time = chrono::steady_clock::now() - start;
+	return {time.count(), tokens};
+}
+
+// returns the number of tokens that differ between the two lexers
+static int compare(const string& file)
+{
+	auto flex = Lexer::create(Lexer::FLEX, file);
+	auto fast = Lexer::create(Lexer::FAST, file);
+	ParserBase::STYPE__ flexVal, fastVal;
+	flex->setSval(&flexVal);
+	fast->setSval(&fastVal);
+
+	for (int diffs = 0;;) {
+		flexVal.t_tok = fastVal.t_tok = nullptr;
+		auto flexId = flex->lex();
+		auto fastId = fast->lex();
+		unique_ptr<Token> flexTok(flexVal.t_tok), fastTok(fastVal.t_tok);
+
+		auto same = flexId == fastId && flex->matched() == fast->matched()
+			&& (!flexTok) == (!fastTok)
+			&& (!flexTok || (flexTok->line == fastTok->line && flexTok->col == fastTok->col));
+		if (!same && diffs++ < 5) {
+			cerr << file << ":" << flex->lineNr() << ": flex '" << flex->matched()
+				<< "' (" << flexId << ") != fast '" << fast->matched() << "' (" << fastId << ")" << endl;
+		}
+		if (!flexId || !fastId)
+			return diffs;
+	}
+}
+
+static void report(const string& name, const Result& result, double megabytes)
+{
+	cout << setw(6) << left << name << right << fixed << setprecision(1)
+		<< setw(10) << megabytes / result.seconds << " MB/s"
+		<< setw(12) << result.tokens / result.seconds / 1e6 << " Mtok/s" << endl;
+}
+
+struct Pattern
+{
+	const char* name;
+	function<string(size_t)> make;
+};
+
+static string repeat(const string& str, size_t size)
+{
+	string out;
+	out.reserve(size + str.size());
+	while (out.size() < size)
+		out += str;
+	return out;
+}
+
+static const vector<Pattern> patterns = {
+	{"comment", [](size_t size){
+		return "/*" + repeat(" * a / b ** c // d\n", size) + "*/\nint x;\n";
+	}},
+	{"comments", [](size_t size){
+		return repeat("/* c */ int x; /* d */\n", size);
+	}},
+	{"nested", [](size_t size){
+		return repeat("/* ", size / 2) + repeat(" */", size / 2) + "\nint x;\n";
+	}},
+	{"string", [](size_t size){
+		return "auto s = \"" + repeat("abc \\\" def \\n ", size) + "\";\n";
+	}},
+	{"line", [](size_t size){
+		return repeat("a = b * c + 12 / d; ", size) + "\n";
+	}}
+};
+
+// lexing time per byte may grow by at most this factor over the sizes
+static const double MaxSlowdown = 2.0;
+
+static int worstCase(int iterations)
+{
+	auto dir = temp_directory_path() / unique_path("lexer-bench-%%%%%%%%");
+	create_directory(dir);
+
+	int failures = 0;
+	cout << setw(10) << left << "pattern" << right << setw(10) << "bytes"
+		<< setw(15) << "flex" << setw(15) << "fast" << endl;
+	for (auto& pattern : patterns) {
+		double flexBase = 0, fastBase = 0, flexWorst = 0, fastWorst = 0;
+		for (size_t size = 1 << 18; size <= 1 << 22; size *= 2) {
+			auto file = (dir / (pattern.name + to_string(size) + ".syp")).string();
+			auto data = pattern.make(size);
+			std::ofstream(file, ios::binary) << data;
+
+			failures += compare(file);
+			auto megabytes = data.size() * iterations / 1e6;
+			auto flex = megabytes / run(Lexer::FLEX, {file}, iterations).seconds;
+			auto fast = megabytes / run(Lexer::FAST, {file}, iterations).seconds;
+			cout << setw(10) << left << pattern.name << right << setw(10) << data.size() << fixed << setprecision(1)
+				<< setw(10) << flex << " MB/s" << setw(10) << fast << " MB/s" << endl;
+
+			if (!flexBase) {
+				flexBase = flex;
+				fastBase = fast;
+			}
+			flexWorst = max(flexWorst, flexBase / flex);
+			fastWorst = max(fastWorst, fastBase / fast);
+		}
+		for (auto lexer : {make_pair("flex", flexWorst), make_pair("fast", fastWorst)}) {
+			if (lexer.second > MaxSlowdown) {
+				cerr << pattern.name << ": " << lexer.first << " slowed down " << setprecision(2)
+					<< lexer.second << "x as the input grew" << endl;
+				failures++;
+			}
+		}
+	}
+	remove_all(dir);
+	return failures? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = 20;
+	bool worst = false;
+	vector<string> files;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			iterations = max(1, stoi(argv[++i]));
+		else if (arg == "--worst-case")
+			worst = true;
+		else
+			files.push_back(arg);
+	}
+	if (worst) {
+		return worstCase(iterations);
+	} else if (files.empty()) {
+		cerr << "usage: " << argv[0] << " [-n iterations] [--worst-case] file.syp..." << endl;
+		return 1;
+	}
+
+	uintmax_t bytes = 0;
+	int diffs = 0;
+	for (auto& file : files) {
+		bytes += file_size(file);
+		diffs += compare(file);
+	}
+	if (diffs)
+		cerr << diffs << " tokens differ" << endl;
+
+	auto megabytes = bytes * iterations / 1e6;
+	auto flex = run(Lexer::FLEX, files, iterations);
+	auto fast = run(Lexer::FAST, files, iterations);
+
+	cout << files.size() << " files, " << bytes << " bytes, " << flex.tokens / iterations << " tokens, "
+		<< iterations << " iterations" << endl;
+	report("flex", flex, megabytes);
+	report("fast", fast, megabytes);
+	cout << "speedup " << setprecision(2) << flex.seconds / fast.seconds << "x" << endl;
+	return diffs? 1 : 0;
+}
@@ -0,0 +1,197 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include "AST.h"
+#include "CodeContext.h"
+#include "Instructions.h"
+#include "Type.h"
+#include "Value.h"
+
+/**
+ * Measures the frontend data structures that show up in profiles, and
+ * reports the cost of each operation in nanoseconds.
+ *
+ * usage: micro-bench [-n scale] [filter]
+ */
+
+// keeps results alive so the measured calls aren't optimized away
+static volatile const void* sink;
+
+static void keep(const void* ptr)
+{
+	sink = ptr;
+}
+
+struct Bench
+{
+	const char* name;
+	size_t ops;
+	// runs the given number of operations
+	function<void(size_t)> run;
+};
+
+static double measure(const Bench& bench, size_t ops)
+{
+	// warm up caches and any lazily created entries
+	bench.run(ops / 10 + 1);
+
+	auto best = 0.0;
+	for (int i = 0; i < 5; i++) {
+		auto start = chrono::steady_clock::now();
+		bench.run(ops);
+		chrono::duration<double, nano> time = chrono::steady_clock::now() - start;
+		if (!i || time.count() < best)
+			best = time.count();
+	}
+	return best / ops;
+}
+
+int main(int argc, char** argv)
+{
+	double scale = 1;
+	string filter;
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			scale = max(0.001, stod(argv[++i]));
+		else
+			filter = arg;
+	}
+
+	LLVMContext llvmContext;
+	Module module("micro-bench", llvmContext);
+	CodeContext context(&module);
+
+	// instructions are inserted into a function that's emptied between runs
+	auto funcType = SType::getFunction(context, SType::getVoid(context), {});
+	auto function = Function::Create(static_cast<FunctionType*>(funcType->type()), GlobalValue::ExternalLinkage, "bench", &module);
+	context.startFuncBlock(SFunction::create(context, function, funcType, nullptr));
+	auto clearBlock = [&]{
+		auto block = context.currBlock();
+		while (!block->empty())
+			block->back().eraseFromParent();
+	};
+
+	vector<SType*> scalars;
+	for (auto bits : {8, 16, 32, 64}) {
+		scalars.push_back(SType::getInt(context, bits));
+		scalars.push_back(SType::getInt(context, bits, true));
+	}
+	scalars.push_back(SType::getFloat(context));
+	scalars.push_back(SType::getFloat(context, true));
+	scalars.push_back(SType::getBool(context));
+
+	vector<string> names;
+	for (int i = 0; i < 64; i++)
+		names.push_back("variable" + to_string(i));
+	auto symbol = RValue::getNumVal(context, SType::getInt(context, 32));
+	context.storeGlobalSymbol(symbol, "global");
+
+	const vector<string> literals = {
+		"\"plain text without escapes\"",
+		"\"line one\\nline two\\n\\ttabbed\\\\\"",
+		"\"\\0\\a\\b\\e\\f\\n\\r\\t\\v\""
+	};
+
+	vector<Bench> benches = {
+		{"TypeManager::getPointer", 2000000, [&](size_t ops){
+			for (size_t i = 0; i < ops; i++)
+				keep(SType::getPointer(context, scalars[i % scalars.size()]));
+		}},
+		{"TypeManager::getArray", 2000000, [&](size_t ops){
+			for (size_t i = 0; i < ops; i++)
+				keep(SType::getArray(context, scalars[i % scalars.size()], i % 64 + 1));
+		}},
+		{"TypeManager::getFunction", 1000000, [&](size_t ops){
+			vector<SType*> params;
+			for (size_t i = 0; i < ops; i++) {
+				params.assign(scalars.begin(), scalars.begin() + i % 4);
+				keep(SType::getFunction(context, scalars[i % scalars.size()], params));
+			}
+		}},
+		{"TypeManager::getConst", 2000000, [&](size_t ops){
+			for (size_t i = 0; i < ops; i++)
+				keep(SType::getConst(context, scalars[i % scalars.size()]));
+		}},
+		{"SymbolTable push/store/lookup/pop", 200000, [&](size_t ops){
+			for (size_t i = 0; i < ops; i++) {
+				// a function scope with a nested block, as CGNStatement creates them
+				context.pushLocalTable();
+				for (int n = 0; n < 8; n++)
+					context.storeLocalSymbol(symbol, names[n]);
+				context.pushLocalTable();
+				for (int n = 8; n < 12; n++)
+					context.storeLocalSymbol(symbol, names[n]);
+				for (int n = 0; n < 12; n++)
+					keep(context.loadSymbol(names[n]).value());
+				keep(context.loadSymbol("global").value());
+				keep(context.loadSymbol(names[63]).value());
+				context.popLocalTable();
+				context.popLocalTable();
+			}
+		}},
+		{"Token::unescape", 1000000, [&](size_t ops){
+			string str;
+			for (size_t i = 0; i < ops; i++) {
+				str = literals[i % literals.size()];
+				Token::unescape(str);
+				keep(str.data());
+			}
+		}},
+		{"NodeList::addFront", 1000000, [&](size_t ops){
+			// prepending the this parameter to a method's parameters
+			NParameterList params(false);
+			params.reserve(8);
+			for (size_t i = 0; i < ops; i++) {
+				params.clear();
+				for (size_t n = 0; n < i % 6; n++)
+					params.add(nullptr);
+				params.addFront(nullptr);
+				keep(&params);
+			}
+		}},
+		{"SType::numericConv", 5000000, [&](size_t ops){
+			auto count = scalars.size();
+			for (size_t i = 0; i < ops; i++)
+				keep(SType::numericConv(context, nullptr, scalars[i % count], scalars[(i / count) % count], i & 1));
+		}},
+		{"Inst::CastMatch", 500000, [&](size_t ops){
+			auto count = scalars.size();
+			for (size_t i = 0; i < ops; i++) {
+				auto lhs = RValue::getNumVal(context, scalars[i % count]);
+				auto rhs = RValue::getNumVal(context, scalars[(i / count) % count]);
+				Inst::CastMatch(context, nullptr, lhs, rhs, i & 1);
+				keep(lhs.value());
+				if (i % 1024 == 1023)
+					clearBlock();
+			}
+			clearBlock();
+		}}
+	};
+
+	for (auto& bench : benches) {
+		if (!filter.empty() && string(bench.name).find(filter) == string::npos)
+			continue;
+		auto ops = max<size_t>(1, bench.ops * scale);
+		cout << setw(36) << left << bench.name << right << fixed << setprecision(1)
+			<< setw(10) << measure(bench, ops) << " ns/op" << endl;
+	}
+	return 0;
+}
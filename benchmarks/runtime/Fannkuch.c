@@ -0,0 +1,61 @@
+/* C reference for Fannkuch.syp */
+#include <stdio.h>
+
+int checksum;
+
+static int fannkuch(int n)
+{
+	int perm[16], perm1[16], count[16];
+	int maxFlips = 0, permCount = 0, r = n;
+
+	checksum = 0;
+	for (int i = 0; i < n; i++)
+		perm1[i] = i;
+
+	for (;;) {
+		while (r != 1) {
+			count[r - 1] = r;
+			r--;
+		}
+		for (int i = 0; i < n; i++)
+			perm[i] = perm1[i];
+
+		int flips = 0;
+		for (;;) {
+			int k = perm[0];
+			if (k == 0)
+				break;
+			int k2 = (k + 1) >> 1;
+			for (int i = 0; i < k2; i++) {
+				int t = perm[i];
+				perm[i] = perm[k - i];
+				perm[k - i] = t;
+			}
+			flips++;
+		}
+		if (flips > maxFlips)
+			maxFlips = flips;
+		checksum += permCount % 2 == 0? flips : -flips;
+
+		for (;;) {
+			if (r == n)
+				return maxFlips;
+			int perm0 = perm1[0];
+			for (int i = 0; i < r; i++)
+				perm1[i] = perm1[i + 1];
+			perm1[r] = perm0;
+			count[r]--;
+			if (count[r] > 0)
+				break;
+			r++;
+		}
+		permCount++;
+	}
+}
+
+int main()
+{
+	int maxFlips = fannkuch(10);
+	printf("%d\n%d\n", checksum, maxFlips);
+	return 0;
+}
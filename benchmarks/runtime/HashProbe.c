@@ -0,0 +1,62 @@
+/* C reference for HashProbe.syp */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static uint32_t hash(uint32_t key)
+{
+	uint32_t h = key;
+	h = ((h >> 16) ^ h) * 0x45d9f3b;
+	h = ((h >> 16) ^ h) * 0x45d9f3b;
+	return (h >> 16) ^ h;
+}
+
+uint32_t seed;
+
+static uint32_t nextKey()
+{
+	seed = seed * 1664525 + 1013904223;
+	return seed | 1;
+}
+
+int main()
+{
+	int bits = 22;
+	uint32_t mask = (1 << bits) - 1;
+	uint32_t* keys = malloc((1 << bits) * sizeof(uint32_t));
+	int* values = malloc((1 << bits) * sizeof(int));
+	for (int i = 0; i < 1 << bits; i++)
+		keys[i] = 0;
+
+	seed = 12345;
+	for (int i = 0; i < 2000000; i++) {
+		uint32_t key = nextKey();
+		uint32_t slot = hash(key) & mask;
+		while (keys[slot] != 0 && keys[slot] != key)
+			slot = (slot + 1) & mask;
+		keys[slot] = key;
+		values[slot] = i;
+	}
+
+	long long hits = 0, sum = 0;
+	for (int round = 0; round < 4; round++) {
+		seed = round % 2 == 0? 12345 : 54321;
+		for (int i = 0; i < 2000000; i++) {
+			uint32_t key = nextKey();
+			uint32_t slot = hash(key) & mask;
+			while (keys[slot] != 0) {
+				if (keys[slot] == key) {
+					hits++;
+					sum += values[slot];
+					break;
+				}
+				slot = (slot + 1) & mask;
+			}
+		}
+	}
+	printf("%lld\n%lld\n", hits, sum);
+
+	free(keys);
+	free(values);
+	return 0;
+}
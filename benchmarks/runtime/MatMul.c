@@ -0,0 +1,45 @@
+/* C reference for MatMul.syp */
+#include <stdio.h>
+#include <stdlib.h>
+
+static void multiply(int n, double* a, double* b, double* c)
+{
+	for (int i = 0; i < n * n; i++)
+		c[i] = 0.0;
+	for (int i = 0; i < n; i++) {
+		for (int k = 0; k < n; k++) {
+			double aik = a[i * n + k];
+			for (int j = 0; j < n; j++)
+				c[i * n + j] += aik * b[k * n + j];
+		}
+	}
+}
+
+int main()
+{
+	int n = 1000;
+	double* a = malloc(n * n * sizeof(double));
+	double* b = malloc(n * n * sizeof(double));
+	double* c = malloc(n * n * sizeof(double));
+	for (int i = 0; i < n; i++) {
+		for (int j = 0; j < n; j++) {
+			a[i * n + j] = (i * 3 + j) % 7 + 1;
+			b[i * n + j] = (i + j * 5) % 11 + 1;
+		}
+	}
+
+	multiply(n, a, b, c);
+
+	double sum = 0.0, trace = 0.0;
+	for (int i = 0; i < n; i++) {
+		trace += c[i * n + i];
+		for (int j = 0; j < n; j++)
+			sum += c[i * n + j] * (j % 3 + 1);
+	}
+	printf("%lld\n%lld\n", (long long) sum, (long long) trace);
+
+	free(a);
+	free(b);
+	free(c);
+	return 0;
+}
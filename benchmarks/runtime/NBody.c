@@ -0,0 +1,98 @@
+/* C reference for NBody.syp */
+#include <math.h>
+#include <stdio.h>
+
+struct Body
+{
+	double x, y, z, vx, vy, vz, mass;
+};
+
+double SolarMass = 39.47841760435743;
+double DaysPerYear = 365.24;
+
+static void setBody(struct Body* b, double x, double y, double z, double vx, double vy, double vz, double mass)
+{
+	b->x = x;
+	b->y = y;
+	b->z = z;
+	b->vx = vx * DaysPerYear;
+	b->vy = vy * DaysPerYear;
+	b->vz = vz * DaysPerYear;
+	b->mass = mass * SolarMass;
+}
+
+static void init(struct Body* bodies)
+{
+	setBody(&bodies[0], 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0);
+	setBody(&bodies[1], 4.84143144246472090e+00, -1.16032004402742839e+00, -1.03622044471123109e-01,
+		1.66007664274403694e-03, 7.69901118419740425e-03, -6.90460016972063023e-05, 9.54791938424326609e-04);
+	setBody(&bodies[2], 8.34336671824457987e+00, 4.12479856412430479e+00, -4.03523417114321381e-01,
+		-2.76742510726862411e-03, 4.99852801234917238e-03, 2.30417297573763929e-05, 2.85885980666130812e-04);
+	setBody(&bodies[3], 1.28943695621391310e+01, -1.51111514016986312e+01, -2.23307578892655734e-01,
+		2.96460137564761618e-03, 2.37847173959480950e-03, -2.96589568540237556e-05, 4.36624404335156298e-05);
+	setBody(&bodies[4], 1.53796971148509165e+01, -2.59193146099879641e+01, 1.79258772950371181e-01,
+		2.68067772490389322e-03, 1.62824170038242295e-03, -9.51592254519715870e-05, 5.15138902046611451e-05);
+
+	double px = 0.0, py = 0.0, pz = 0.0;
+	for (int i = 0; i < 5; i++) {
+		px += bodies[i].vx * bodies[i].mass;
+		py += bodies[i].vy * bodies[i].mass;
+		pz += bodies[i].vz * bodies[i].mass;
+	}
+	bodies[0].vx = -px / SolarMass;
+	bodies[0].vy = -py / SolarMass;
+	bodies[0].vz = -pz / SolarMass;
+}
+
+static void advance(struct Body* bodies, double dt)
+{
+	for (int i = 0; i < 5; i++) {
+		for (int j = i + 1; j < 5; j++) {
+			double dx = bodies[i].x - bodies[j].x;
+			double dy = bodies[i].y - bodies[j].y;
+			double dz = bodies[i].z - bodies[j].z;
+			double d2 = dx * dx + dy * dy + dz * dz;
+			double mag = dt / (d2 * sqrt(d2));
+
+			bodies[i].vx -= dx * bodies[j].mass * mag;
+			bodies[i].vy -= dy * bodies[j].mass * mag;
+			bodies[i].vz -= dz * bodies[j].mass * mag;
+			bodies[j].vx += dx * bodies[i].mass * mag;
+			bodies[j].vy += dy * bodies[i].mass * mag;
+			bodies[j].vz += dz * bodies[i].mass * mag;
+		}
+	}
+	for (int i = 0; i < 5; i++) {
+		bodies[i].x += dt * bodies[i].vx;
+		bodies[i].y += dt * bodies[i].vy;
+		bodies[i].z += dt * bodies[i].vz;
+	}
+}
+
+static double energy(struct Body* bodies)
+{
+	double e = 0.0;
+	for (int i = 0; i < 5; i++) {
+		e += 0.5 * bodies[i].mass * (bodies[i].vx * bodies[i].vx
+			+ bodies[i].vy * bodies[i].vy + bodies[i].vz * bodies[i].vz);
+		for (int j = i + 1; j < 5; j++) {
+			double dx = bodies[i].x - bodies[j].x;
+			double dy = bodies[i].y - bodies[j].y;
+			double dz = bodies[i].z - bodies[j].z;
+			e -= bodies[i].mass * bodies[j].mass / sqrt(dx * dx + dy * dy + dz * dz);
+		}
+	}
+	return e;
+}
+
+int main()
+{
+	struct Body bodies[5];
+	init(bodies);
+
+	printf("%lld\n", (long long) (energy(bodies) * 1000000000.0));
+	for (int i = 0; i < 5000000; i++)
+		advance(bodies, 0.01);
+	printf("%lld\n", (long long) (energy(bodies) * 1000000000.0));
+	return 0;
+}
@@ -0,0 +1,62 @@
+/* C reference for SpectralNorm.syp */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static double evalA(int i, int j)
+{
+	return 1.0 / ((i + j) * (i + j + 1) / 2 + i + 1);
+}
+
+static void multiplyAv(int n, double* v, double* av)
+{
+	for (int i = 0; i < n; i++) {
+		double sum = 0.0;
+		for (int j = 0; j < n; j++)
+			sum += evalA(i, j) * v[j];
+		av[i] = sum;
+	}
+}
+
+static void multiplyAtv(int n, double* v, double* atv)
+{
+	for (int i = 0; i < n; i++) {
+		double sum = 0.0;
+		for (int j = 0; j < n; j++)
+			sum += evalA(j, i) * v[j];
+		atv[i] = sum;
+	}
+}
+
+static void multiplyAtAv(int n, double* v, double* atav, double* tmp)
+{
+	multiplyAv(n, v, tmp);
+	multiplyAtv(n, tmp, atav);
+}
+
+int main()
+{
+	int n = 3000;
+	double* u = malloc(n * sizeof(double));
+	double* v = malloc(n * sizeof(double));
+	double* tmp = malloc(n * sizeof(double));
+	for (int i = 0; i < n; i++)
+		u[i] = 1.0;
+
+	for (int i = 0; i < 10; i++) {
+		multiplyAtAv(n, u, v, tmp);
+		multiplyAtAv(n, v, u, tmp);
+	}
+
+	double vBv = 0.0, vv = 0.0;
+	for (int i = 0; i < n; i++) {
+		vBv += u[i] * v[i];
+		vv += v[i] * v[i];
+	}
+	printf("%lld\n", (long long) (sqrt(vBv / vv) * 1000000000.0));
+
+	free(u);
+	free(v);
+	free(tmp);
+	return 0;
+}
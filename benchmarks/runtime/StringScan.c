@@ -0,0 +1,67 @@
+/* C reference for StringScan.syp */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+uint32_t seed;
+
+static void fill(char* text, int size)
+{
+	const char* alphabet = "etaoin shrdlu\nthe cmfwyp";
+	seed = 42;
+	for (int i = 0; i < size; i++) {
+		seed = seed * 1664525 + 1013904223;
+		text[i] = alphabet[(seed >> 8) % 24];
+	}
+}
+
+static long long countPattern(const char* text, int size, const char* pattern, int len)
+{
+	long long count = 0;
+	for (int i = 0; i + len <= size; i++) {
+		int j = 0;
+		while (j < len && text[i + j] == pattern[j])
+			j++;
+		if (j == len)
+			count++;
+	}
+	return count;
+}
+
+int main()
+{
+	int size = 16 << 20;
+	char* text = malloc(size);
+	fill(text, size);
+
+	long long lines = 0, words = 0, found = 0;
+	long long histogram[256];
+	for (int i = 0; i < 256; i++)
+		histogram[i] = 0;
+
+	for (int round = 0; round < 4; round++) {
+		int inWord = 0;
+		for (int i = 0; i < size; i++) {
+			uint8_t c = text[i];
+			histogram[c]++;
+			if (c == '\n')
+				lines++;
+			if (c == ' ' || c == '\n') {
+				inWord = 0;
+			} else if (!inWord) {
+				inWord = 1;
+				words++;
+			}
+		}
+		found += countPattern(text, size, "the", 3);
+	}
+
+	long long check = 0;
+	for (int i = 0; i < 256; i++)
+		check += histogram[i] * (i + 1);
+
+	printf("%lld\n%lld\n%lld\n%lld\n", lines, words, found, check);
+
+	free(text);
+	return 0;
+}
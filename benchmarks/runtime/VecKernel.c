@@ -0,0 +1,47 @@
+/* C reference for VecKernel.syp, using the GCC vector extension */
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef float vec4 __attribute__((vector_size(16)));
+
+static void saxpy(int n, float a, vec4* x, vec4* y)
+{
+	vec4 av = {a, a, a, a};
+	for (int i = 0; i < n; i++)
+		y[i] = av * x[i] + y[i];
+}
+
+static vec4 dot(int n, vec4* x, vec4* y)
+{
+	vec4 acc = {0, 0, 0, 0};
+	for (int i = 0; i < n; i++)
+		acc += x[i] * y[i];
+	return acc;
+}
+
+int main()
+{
+	int n = 1 << 16;
+	vec4* x = aligned_alloc(16, n * sizeof(vec4));
+	vec4* y = aligned_alloc(16, n * sizeof(vec4));
+	for (int i = 0; i < n; i++) {
+		for (int lane = 0; lane < 4; lane++) {
+			float xv = (i * 4 + lane) % 16, yv = (i + lane * 3) % 8;
+			x[i][lane] = xv / 64;
+			y[i][lane] = yv / 64;
+		}
+	}
+
+	long long total = 0;
+	for (int round = 0; round < 2000; round++) {
+		float a = round % 2 == 0? 0.5 : -0.5;
+		saxpy(n, a, x, y);
+		vec4 acc = dot(n, x, y);
+		total += (long long) ((acc[0] + acc[1] + acc[2] + acc[3]) * 64);
+	}
+	printf("%lld\n", total);
+
+	free(x);
+	free(y);
+	return 0;
+}
@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+#
+# Saphyr, a C++ style compiler using LLVM
+# Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Compiles each kernel with saphyr and its C reference with clang, checks
+# they print the same output and reports their relative runtimes as JSON.
+
+import os, sys, glob, json, time, shutil, tempfile, argparse, subprocess
+
+SAPHYR_BIN = "../../saphyr"
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# saphyr optimizes at -O2 for the host CPU (see ModuleWriter), so the C
+# reference does too. Neither may fuse multiplies and adds, keeping the
+# floating point results identical.
+C_FLAGS = ["-O2", "-march=native", "-ffp-contract=off"]
+
+def check(cmd, cwd):
+	proc = subprocess.run(cmd, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+	if proc.returncode:
+		sys.exit("failed: " + " ".join(cmd) + "\n" + proc.stdout.decode())
+
+def build(name, saphyr, cc, workDir):
+	check([saphyr, "--whole-program", name + ".syp"], workDir)
+	check([cc, "-no-pie", name + ".o", "-lm", "-o", name + "-syp"], workDir)
+	check([cc] + C_FLAGS + [name + ".c", "-lm", "-o", name + "-c"], workDir)
+
+def timed(binary, cwd, repeat):
+	best, output = None, None
+	for i in range(repeat):
+		start = time.perf_counter()
+		proc = subprocess.run([binary], cwd=cwd, stdout=subprocess.PIPE)
+		seconds = time.perf_counter() - start
+		if proc.returncode:
+			sys.exit("failed: " + binary + " exited with " + str(proc.returncode))
+		best = seconds if best is None else min(best, seconds)
+		output = proc.stdout.decode()
+	return best, output
+
+def main(argv):
+	parser = argparse.ArgumentParser(description="compare saphyr generated code against C")
+	parser.add_argument("kernels", nargs="*", help="kernels to run (default: all)")
+	parser.add_argument("-r", "--repeat", type=int, default=3, help="runs of each binary, the fastest is reported")
+	parser.add_argument("-o", "--output", help="write the JSON results to the given file instead of stdout")
+	parser.add_argument("--saphyr", default=SAPHYR_BIN)
+	parser.add_argument("--cc", default=os.environ.get("CC", "clang"))
+	args = parser.parse_args(argv)
+
+	saphyr = os.path.abspath(args.saphyr)
+	kernels = args.kernels or sorted(os.path.basename(f)[:-2] for f in glob.glob(os.path.join(HERE, "*.c")))
+
+	results = []
+	failed = False
+	workDir = tempfile.mkdtemp(prefix="saphyr-runtime-")
+	try:
+		for file in glob.glob(os.path.join(HERE, "*.syp")) + glob.glob(os.path.join(HERE, "*.c")):
+			shutil.copy(file, workDir)
+		for name in kernels:
+			if not os.path.exists(os.path.join(workDir, name + ".c")):
+				sys.exit("unknown kernel: " + name)
+			build(name, saphyr, args.cc, workDir)
+			sypTime, sypOut = timed(os.path.join(workDir, name + "-syp"), workDir, args.repeat)
+			cTime, cOut = timed(os.path.join(workDir, name + "-c"), workDir, args.repeat)
+
+			match = sypOut == cOut
+			failed |= not match
+			results.append({"kernel": name, "saphyrSeconds": sypTime, "cSeconds": cTime,
+				"ratio": sypTime / cTime, "outputMatches": match})
+			print("{:14} saphyr {:7.3f}s  c {:7.3f}s  {:5.2f}x{}".format(name, sypTime, cTime,
+				sypTime / cTime, "" if match else "  OUTPUT DIFFERS"), file=sys.stderr)
+			if not match:
+				print("saphyr:\n" + sypOut + "c:\n" + cOut, file=sys.stderr)
+	finally:
+		shutil.rmtree(workDir)
+
+	text = json.dumps(results, indent=2)
+	if args.output:
+		with open(args.output, "w") as f:
+			f.write(text + "\n")
+	else:
+		print(text)
+	return 1 if failed else 0
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv[1:]))
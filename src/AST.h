@@ -20,6 +20,7 @@
 #include <vector>
 #include <set>
 #include <algorithm>
+#include <functional>
 #include "BaseNodes.h"
 
 using namespace std;
@@ -356,6 +357,34 @@ public:
 	ADD_ID(NConstType);
 };
 
+class NAtomicType : public NDataType
+{
+	Token* atomicTok;
+	NDataType* type;
+
+public:
+	NAtomicType(Token* atomicTok, NDataType* type)
+	: atomicTok(atomicTok), type(type) {}
+
+	operator Token*() const
+	{
+		return atomicTok;
+	}
+
+	NDataType* getType() const
+	{
+		return type;
+	}
+
+	~NAtomicType()
+	{
+		delete atomicTok;
+		delete type;
+	}
+
+	ADD_ID(NAtomicType);
+};
+
 class NThisType : public NNamedType
 {
 public:
@@ -436,9 +465,21 @@ public:
 
 class NUserType : public NNamedType
 {
+	NDataTypeList* genericArgs;
+
 public:
-	explicit NUserType(Token* name)
-	: NNamedType(name) {}
+	explicit NUserType(Token* name, NDataTypeList* genericArgs = nullptr)
+	: NNamedType(name), genericArgs(genericArgs) {}
+
+	NDataTypeList* getGenericArgs() const
+	{
+		return genericArgs;
+	}
+
+	~NUserType()
+	{
+		delete genericArgs;
+	}
 
 	ADD_ID(NUserType)
 };
@@ -511,14 +552,16 @@ class NVariableDecl : public NDeclaration
 protected:
 	NExpression* initExp;
 	NExpressionList* initList;
+	NIntConst* bitWidth;
 	NDataType* type;
+	NAttributeList* attrs;
 
 public:
 	NVariableDecl(Token* name, NExpression* initExp = nullptr)
-	: NDeclaration(name), initExp(initExp), initList(nullptr), type(nullptr) {}
+	: NDeclaration(name), initExp(initExp), initList(nullptr), bitWidth(nullptr), type(nullptr), attrs(nullptr) {}
 
 	NVariableDecl(Token* name, NExpressionList* initList)
-	: NDeclaration(name), initExp(nullptr), initList(initList), type(nullptr) {}
+	: NDeclaration(name), initExp(nullptr), initList(initList), bitWidth(nullptr), type(nullptr), attrs(nullptr) {}
 
 	NDataType* getType() const
 	{
@@ -531,6 +574,17 @@ public:
 		type = qtype;
 	}
 
+	NAttributeList* getAttrs() const
+	{
+		return attrs;
+	}
+
+	// NOTE: must be called before genCode()
+	void setAttrs(NAttributeList* qattrs)
+	{
+		attrs = qattrs;
+	}
+
 	bool hasInit() const
 	{
 		return initExp || initList;
@@ -546,10 +600,21 @@ public:
 		return initList;
 	}
 
+	NIntConst* getBitWidth() const
+	{
+		return bitWidth;
+	}
+
+	void setBitWidth(NIntConst* width)
+	{
+		bitWidth = width;
+	}
+
 	~NVariableDecl()
 	{
 		delete initExp;
 		delete initList;
+		delete bitWidth;
 	}
 
 	ADD_ID(NVariableDecl)
@@ -774,10 +839,11 @@ class NVariableDeclGroup : public NStatement
 {
 	NDataType* type;
 	NVariableDeclList* variables;
+	NAttributeList* attrs;
 
 public:
-	NVariableDeclGroup(NDataType* type, NVariableDeclList* variables)
-	: type(type), variables(variables) {}
+	NVariableDeclGroup(NDataType* type, NVariableDeclList* variables, NAttributeList* attrs = nullptr)
+	: type(type), variables(variables), attrs(attrs) {}
 
 	NDataType* getType() const
 	{
@@ -789,10 +855,16 @@ public:
 		return variables;
 	}
 
+	NAttributeList* getAttrs() const
+	{
+		return attrs;
+	}
+
 	~NVariableDeclGroup()
 	{
 		delete variables;
 		delete type;
+		delete attrs;
 	}
 
 	ADD_ID(NVariableDeclGroup)
@@ -829,10 +901,11 @@ private:
 	NVariableDeclGroupList* list;
 	NAttributeList* attrs;
 	CreateType ctype;
+	NDataTypeList* genericParams;
 
 public:
-	NStructDeclaration(Token* name, NVariableDeclGroupList* list, NAttributeList* attrs, CreateType ctype)
-	: NDeclaration(name), list(list), attrs(attrs), ctype(ctype) {}
+	NStructDeclaration(Token* name, NVariableDeclGroupList* list, NAttributeList* attrs, CreateType ctype, NDataTypeList* genericParams = nullptr)
+	: NDeclaration(name), list(list), attrs(attrs), ctype(ctype), genericParams(genericParams) {}
 
 	CreateType getType() const
 	{
@@ -849,10 +922,16 @@ public:
 		return attrs;
 	}
 
+	NDataTypeList* getGenericParams() const
+	{
+		return genericParams;
+	}
+
 	~NStructDeclaration()
 	{
 		delete list;
 		delete attrs;
+		delete genericParams;
 	}
 
 	ADD_ID(NStructDeclaration)
@@ -892,10 +971,11 @@ class NFunctionDeclaration : public NDeclaration
 	NParameterList* params;
 	NStatementList* body;
 	NAttributeList* attrs;
+	NDataTypeList* genericParams;
 
 public:
-	NFunctionDeclaration(Token* name, NDataType* rtype, NParameterList* params, NStatementList* body, NAttributeList* attrs)
-	: NDeclaration(name), rtype(rtype), params(params), body(body), attrs(attrs) {}
+	NFunctionDeclaration(Token* name, NDataType* rtype, NParameterList* params, NStatementList* body, NAttributeList* attrs, NDataTypeList* genericParams = nullptr)
+	: NDeclaration(name), rtype(rtype), params(params), body(body), attrs(attrs), genericParams(genericParams) {}
 
 	NDataType* getRType() const
 	{
@@ -917,12 +997,18 @@ public:
 		return attrs;
 	}
 
+	NDataTypeList* getGenericParams() const
+	{
+		return genericParams;
+	}
+
 	~NFunctionDeclaration()
 	{
 		delete rtype;
 		delete params;
 		delete body;
 		delete attrs;
+		delete genericParams;
 	}
 
 	ADD_ID(NFunctionDeclaration)
@@ -989,10 +1075,11 @@ class NClassDeclaration : public NDeclaration
 {
 	NClassMemberList* list;
 	NAttributeList* attrs;
+	NDataTypeList* genericParams;
 
 public:
-	NClassDeclaration(Token* name, NClassMemberList* list, NAttributeList* attrs)
-	: NDeclaration(name), list(list), attrs(attrs)
+	NClassDeclaration(Token* name, NClassMemberList* list, NAttributeList* attrs, NDataTypeList* genericParams = nullptr)
+	: NDeclaration(name), list(list), attrs(attrs), genericParams(genericParams)
 	{
 		if (list) {
 			for (auto i : *list)
@@ -1017,10 +1104,16 @@ public:
 		return attrs;
 	}
 
+	NDataTypeList* getGenericParams() const
+	{
+		return genericParams;
+	}
+
 	~NClassDeclaration()
 	{
 		delete list;
 		delete attrs;
+		delete genericParams;
 	}
 
 	ADD_ID(NClassDeclaration)
@@ -1058,10 +1151,11 @@ class NClassFunctionDecl : public NClassMember
 	NParameterList* params;
 	NStatementList* body;
 	NAttributeList* attrs;
+	bool hasThis;
 
 public:
 	NClassFunctionDecl(Token* name, NDataType* rtype, NParameterList* params, NStatementList* body, NAttributeList* attrs = nullptr)
-	: NClassMember(name), rtype(rtype), params(params), body(body), attrs(attrs) {}
+	: NClassMember(name), rtype(rtype), params(params), body(body), attrs(attrs), hasThis(false) {}
 
 	MemberType memberType() const
 	{
@@ -1073,6 +1167,19 @@ public:
 		return params;
 	}
 
+	// the declaration can be visited again (imports kept between
+	// compiles), so the implicit this parameter is only added once
+	bool hasThisParam() const
+	{
+		return hasThis;
+	}
+
+	void addThisParam(NParameter* thisParam)
+	{
+		params->addFront(thisParam);
+		hasThis = true;
+	}
+
 	NDataType* getRType() const
 	{
 		return rtype;
@@ -1302,10 +1409,11 @@ class NForStatement : public NConditionStmt
 {
 	NStatementList* preStm;
 	NExpressionList* postExp;
+	NAttributeList* attrs;
 
 public:
-	NForStatement(NStatementList* preStm, NExpression* condition, NExpressionList* postExp, NStatementList* body)
-	: NConditionStmt(condition, body), preStm(preStm), postExp(postExp) {}
+	NForStatement(NStatementList* preStm, NExpression* condition, NExpressionList* postExp, NStatementList* body, NAttributeList* attrs = nullptr)
+	: NConditionStmt(condition, body), preStm(preStm), postExp(postExp), attrs(attrs) {}
 
 	NStatementList* getPreStm() const
 	{
@@ -1317,10 +1425,16 @@ public:
 		return postExp;
 	}
 
+	NAttributeList* getAttrs() const
+	{
+		return attrs;
+	}
+
 	~NForStatement()
 	{
 		delete preStm;
 		delete postExp;
+		delete attrs;
 	}
 
 	ADD_ID(NForStatement)
@@ -1393,6 +1507,55 @@ public:
 	ADD_ID(NReturnStatement)
 };
 
+class NYieldStatement : public NStatement
+{
+	Token* yieldToken;
+
+public:
+	explicit NYieldStatement(Token* yieldToken)
+	: yieldToken(yieldToken) {}
+
+	operator Token*() const
+	{
+		return yieldToken;
+	}
+
+	~NYieldStatement()
+	{
+		delete yieldToken;
+	}
+
+	ADD_ID(NYieldStatement)
+};
+
+class NAwaitStatement : public NStatement
+{
+	Token* awaitToken;
+	NExpression* exp;
+
+public:
+	NAwaitStatement(Token* awaitToken, NExpression* exp)
+	: awaitToken(awaitToken), exp(exp) {}
+
+	NExpression* getExp() const
+	{
+		return exp;
+	}
+
+	operator Token*() const
+	{
+		return awaitToken;
+	}
+
+	~NAwaitStatement()
+	{
+		delete awaitToken;
+		delete exp;
+	}
+
+	ADD_ID(NAwaitStatement)
+};
+
 class NGotoStatement : public NJumpStatement
 {
 	Token* name;
@@ -1598,10 +1761,11 @@ class NNewExpression : public NExpression
 	NDataType* type;
 	Token* token;
 	NExpressionList* args;
+	NVariable* arena;
 
 public:
-	NNewExpression(Token* token, NDataType* type, NExpressionList* args = nullptr)
-	: type(type), token(token), args(args) {}
+	NNewExpression(Token* token, NDataType* type, NExpressionList* args = nullptr, NVariable* arena = nullptr)
+	: type(type), token(token), args(args), arena(arena) {}
 
 	NDataType* getType() const
 	{
@@ -1613,6 +1777,11 @@ public:
 		return args;
 	}
 
+	NVariable* getArena() const
+	{
+		return arena;
+	}
+
 	operator Token*() const
 	{
 		return token;
@@ -1623,6 +1792,7 @@ public:
 		delete type;
 		delete token;
 		delete args;
+		delete arena;
 	}
 
 	ADD_ID(NNewExpression)
@@ -1694,7 +1864,7 @@ public:
 class NArrowOperator : public NVariable
 {
 public:
-	enum OfType { DATA, EXP };
+	enum OfType { DATA, EXP, ATOMIC };
 
 private:
 	OfType type;
@@ -1702,13 +1872,21 @@ private:
 	NExpression* exp;
 	Token* name;
 	NDataTypeList* args;
+	NExpressionList* expArgs;
+	Token* atomicTok;
 
 public:
 	NArrowOperator(NDataType* dtype, Token* name, NDataTypeList* args)
-	: type(DATA), dtype(dtype), exp(nullptr), name(name), args(args) {}
+	: type(DATA), dtype(dtype), exp(nullptr), name(name), args(args), expArgs(nullptr), atomicTok(nullptr) {}
 
 	NArrowOperator(NExpression* exp, Token* name, NDataTypeList* args)
-	: type(EXP), dtype(nullptr), exp(exp), name(name), args(args) {}
+	: type(EXP), dtype(nullptr), exp(exp), name(name), args(args), expArgs(nullptr), atomicTok(nullptr) {}
+
+	NArrowOperator(NExpression* exp, Token* name, NExpressionList* expArgs)
+	: type(EXP), dtype(nullptr), exp(exp), name(name), args(nullptr), expArgs(expArgs), atomicTok(nullptr) {}
+
+	NArrowOperator(Token* atomicTok, Token* name, NExpressionList* expArgs)
+	: type(ATOMIC), dtype(nullptr), exp(nullptr), name(name), args(nullptr), expArgs(expArgs), atomicTok(atomicTok) {}
 
 	OfType getType() const
 	{
@@ -1735,18 +1913,29 @@ public:
 		return args;
 	}
 
+	NExpressionList* getExpArgs() const
+	{
+		return expArgs;
+	}
+
 	operator Token*() const
 	{
 		switch (type) {
 		default:
 		case DATA: return *dtype;
 		case EXP: return *exp;
+		case ATOMIC: return atomicTok;
 		}
 	}
 
 	bool isConstant() const
 	{
-		return type == EXP? exp->isConstant() : true;
+		switch (type) {
+		default:
+		case DATA: return true;
+		case EXP: return !expArgs && exp->isConstant();
+		case ATOMIC: return false;
+		}
 	}
 
 	~NArrowOperator()
@@ -1755,6 +1944,8 @@ public:
 		delete exp;
 		delete name;
 		delete args;
+		delete expArgs;
+		delete atomicTok;
 	}
 
 	ADD_ID(NArrowOperator)
@@ -1793,10 +1984,11 @@ class NFunctionCall : public NVariable
 {
 	Token* name;
 	NExpressionList* arguments;
+	NDataTypeList* genericArgs;
 
 public:
-	NFunctionCall(Token* name, NExpressionList* arguments)
-	: name(name), arguments(arguments) {}
+	NFunctionCall(Token* name, NExpressionList* arguments, NDataTypeList* genericArgs = nullptr)
+	: name(name), arguments(arguments), genericArgs(genericArgs) {}
 
 	operator Token*() const
 	{
@@ -1813,10 +2005,16 @@ public:
 		return name;
 	}
 
+	NDataTypeList* getGenericArgs() const
+	{
+		return genericArgs;
+	}
+
 	~NFunctionCall()
 	{
 		delete name;
 		delete arguments;
+		delete genericArgs;
 	}
 
 	ADD_ID(NFunctionCall)
@@ -29,6 +29,7 @@ enum class NodeId
 
 	// datatypes
 	NArrayType,
+	NAtomicType,
 	NBaseType,
 	NConstType,
 	NFuncPointerType,
@@ -65,6 +66,7 @@ enum class NodeId
 
 	// statements
 	NAliasDeclaration,
+	NAwaitStatement,
 	NClassConstructor,
 	NClassDeclaration,
 	NClassDestructor,
@@ -93,6 +95,7 @@ enum class NodeId
 	NVariableDecl,
 	NVariableDeclGroup,
 	NWhileStatement,
+	NYieldStatement,
 };
 
 #define ADD_ID(CLASS) NodeId id() { return NodeId::CLASS; }
@@ -276,6 +279,9 @@ public:
 		Token::unescape(value->str);
 	}
 
+	NAttrValue(const NAttrValue& other)
+	: val(new Token(*other.val)) {}
+
 	operator Token*() const
 	{
 		return val;
@@ -297,6 +303,14 @@ public:
 class NAttrValueList : public NodeList<NAttrValue>
 {
 public:
+	NAttrValueList* copy()
+	{
+		auto list = new NAttrValueList;
+		for (auto item : *this)
+			list->add(new NAttrValue(*item));
+		return list;
+	}
+
 	static NAttrValue* find(NAttrValueList* list, int index)
 	{
 		if (!list)
@@ -314,6 +328,9 @@ public:
 	explicit NAttribute(Token* name, NAttrValueList* values = nullptr)
 	: name(name), values(values) {}
 
+	NAttribute(const NAttribute& other)
+	: name(new Token(*other.name)), values(other.values? other.values->copy() : nullptr) {}
+
 	operator Token*() const
 	{
 		return name;
@@ -341,6 +358,14 @@ public:
 class NAttributeList : public NodeList<NAttribute>
 {
 public:
+	NAttributeList* copy()
+	{
+		auto list = new NAttributeList;
+		for (auto item : *this)
+			list->add(new NAttribute(*item));
+		return list;
+	}
+
 	static NAttribute* find(NAttributeList* list, const string& name)
 	{
 		if (!list)
@@ -27,6 +27,9 @@
 #include "CGNStatement.h"
 #include "CGNImportStm.h"
 #include "Instructions.h"
+#include "ImportCache.h"
+#include "ConstEval.h"
+#include "PhaseTimer.h"
 #include "Util.h"
 
 SFunction Builder::CreateFunction(CodeContext& context, Token* name, NDataType* rtype, NParameterList* params, NStatementList* body, NAttributeList* attrs)
@@ -43,15 +46,26 @@ SFunction Builder::CreateFunction(CodeContext& context, Token* name, NDataType*
 		return SFunction();
 	}
 
+	// async functions return their coroutine handle
+	auto returnType = function.returnTy();
+	auto async = NAttributeList::find(attrs, "async");
+	if (async && !(returnType->isPointer() && returnType->subType()->isVoid())) {
+		context.addError("async function " + name->str + " must return @void", name);
+		return SFunction();
+	}
+
 	if (body->empty() || !body->back()->isTerminator()) {
-		auto returnType = function.returnTy();
-		if (returnType->isVoid())
+		if (returnType->isVoid() || async)
 			body->add(new NReturnStatement);
 		else
 			context.addError("no return for a non-void function", name);
 	}
 
 	context.startFuncBlock(function);
+	if (async && !Inst::CoroutineBegin(context, name)) {
+		context.endFuncBlock();
+		return function;
+	}
 
 	int i = 0;
 	set<string> names;
@@ -68,11 +82,17 @@ SFunction Builder::CreateFunction(CodeContext& context, Token* name, NDataType*
 	}
 
 	CGNStatement::run(context, body);
+	if (context.inCoroutine())
+		Inst::CoroutineEnd(context, name);
 	context.endFuncBlock();
+
+	// every module using an instance emits its own copy
+	if (context.inGeneric())
+		static_cast<Function*>(function)->setLinkage(GlobalValue::LinkOnceODRLinkage);
 	return function;
 }
 
-void Builder::CreateClassFunction(CodeContext& context, NClassFunctionDecl* stm, bool prototype)
+void Builder::CreateClassFunction(CodeContext& context, NClassFunctionDecl* stm, bool prototype, NStatementList* body)
 {
 	validateAttrList(context, stm->getAttrs());
 
@@ -80,41 +100,43 @@ void Builder::CreateClassFunction(CodeContext& context, NClassFunctionDecl* stm,
 	auto theClass = stm->getClass();
 	auto clType = context.getClass();
 	auto item = clType->getItem(name->str);
-	if (item) {
+	if (item && (prototype || !isPrototype(item->second))) {
 		context.addError("class " + theClass->getName()->str + " already defines symbol " + name->str, name);
 		return;
 	}
 
-	// add this parameter
-	if (!NAttributeList::find(stm->getAttrs(), "static")) {
+	// add this parameter to instance methods
+	if (!stm->hasThisParam() && !NAttributeList::find(stm->getAttrs(), "static")) {
 		auto thisToken = new Token(*theClass->getName());
-		auto thisPtr = new NParameter(new NPointerType(new NUserType(thisToken)), new Token("this"));
-		stm->getParams()->addFront(thisPtr);
+		stm->addThisParam(new NParameter(new NPointerType(new NThisType(thisToken)), new Token("this")));
 	}
 
 	auto fnToken = *name;
 	fnToken.str = theClass->getName()->str + "_" + name->str;
 
 	// add function to class type
-	auto func = CreateFunction(context, &fnToken, stm->getRType(), stm->getParams(), prototype? nullptr : stm->getBody(), stm->getAttrs());
+	auto func = CreateFunction(context, &fnToken, stm->getRType(), stm->getParams(), prototype? nullptr : (body? body : stm->getBody()), stm->getAttrs());
 	if (func)
 		clType->addFunction(name->str, func);
 }
 
 void Builder::CreateClassConstructor(CodeContext& context, NClassConstructor* stm, bool prototype)
 {
+	// the implicit initializers depend on the class instance, so they're
+	// added to a copy of the body instead of the shared declaration
 	map<string,NMemberInitializer*> items;
 	for (auto item : *stm->getInitList()) {
 		auto token = item->getName();
 		auto it = items.find(token->str);
 		if (it != items.end()) {
-			context.addError("initializer for " + token->str + " already defined", token);
+			if (!prototype)
+				context.addError("initializer for " + token->str + " already defined", token);
 			continue;
 		}
 		items.insert({token->str, item});
 	}
-	stm->getInitList()->clear();
 
+	NStatementList implicit;
 	auto classTy = context.getClass();
 	for (auto item : *classTy) {
 		auto stype = item.second.second.stype();
@@ -125,29 +147,35 @@ void Builder::CreateClassConstructor(CodeContext& context, NClassConstructor* st
 			continue;
 		auto clTy = static_cast<SClassType*>(stype);
 		if (clTy->getItem("this")) {
-			items.insert({item.first, new NMemberInitializer(new Token(item.first), new NExpressionList)});
+			auto init = new NMemberInitializer(new Token(item.first), new NExpressionList);
+			implicit.add(init);
+			items.insert({item.first, init});
 		}
 	}
 
-	if (!items.empty()) {
-		auto newBody = new NStatementList;
-		newBody->reserve(items.size() + stm->getBody()->size());
-		for (auto item : items)
-			newBody->add(item.second);
-		newBody->addAll(*stm->getBody());
-		stm->getBody()->setDelete(false);
-		stm->setBody(newBody);
-	}
+	NStatementList body(false);
+	body.reserve(items.size() + stm->getBody()->size());
+	for (auto item : items)
+		body.add(item.second);
+	body.addAll(*stm->getBody());
 
-	if (stm->getBody()->empty())
+	if (body.empty())
 		return;
 
-	stm->setRType(new NBaseType(nullptr, ParserBase::TT_VOID));
-	CreateClassFunction(context, stm, prototype);
+	if (!stm->getRType())
+		stm->setRType(new NBaseType(nullptr, ParserBase::TT_VOID));
+	auto size = body.size();
+	CreateClassFunction(context, stm, prototype, &body);
+
+	// body doesn't own the return CreateFunction may append
+	for (int i = size; i < body.size(); i++)
+		implicit.add(body.at(i));
 }
 
 void Builder::CreateClassDestructor(CodeContext& context, NClassDestructor* stm, bool prototype)
 {
+	// as with constructors, the member destructor calls are per instance
+	NStatementList calls;
 	auto clType = context.getClass();
 	for (auto item : *clType) {
 		auto ty = item.second.second.stype();
@@ -156,16 +184,25 @@ void Builder::CreateClassDestructor(CodeContext& context, NClassDestructor* stm,
 		auto itemCl = static_cast<SClassType*>(ty);
 		if (!itemCl->getItem("null"))
 			continue;
-		stm->getBody()->add(new NDestructorCall(new NBaseVariable(new Token(item.first)), nullptr));
+		calls.add(new NDestructorCall(new NBaseVariable(new Token(item.first)), nullptr));
 	}
 
-	if (stm->getBody()->empty())
+	NStatementList body(false);
+	body.reserve(stm->getBody()->size() + calls.size());
+	body.addAll(*stm->getBody());
+	body.addAll(calls);
+
+	if (body.empty())
 		return;
 
-	stm->setRType(new NBaseType(nullptr, ParserBase::TT_VOID));
+	if (!stm->getRType())
+		stm->setRType(new NBaseType(nullptr, ParserBase::TT_VOID));
 	stm->getName()->str = "null";
 
-	CreateClassFunction(context, stm, prototype);
+	auto size = body.size();
+	CreateClassFunction(context, stm, prototype, &body);
+	for (int i = size; i < body.size(); i++)
+		calls.add(body.at(i));
 }
 
 void Builder::CreateClass(CodeContext& context, NClassDeclaration* stm, function<void(int)> visitor)
@@ -225,6 +262,22 @@ void Builder::CreateClass(CodeContext& context, NClassDeclaration* stm, function
 	visitor(structIdx);
 }
 
+void Builder::CreateClassAllocator(CodeContext& context, NClassDeclaration* stm)
+{
+	auto attr = NAttributeList::find(stm->getAttrs(), "allocator");
+	if (!attr)
+		return;
+
+	auto value = NAttrValueList::find(attr->getValues(), 0);
+	if (!value) {
+		context.addError("allocator attribute requires value", *attr);
+		return;
+	}
+	auto clType = SUserType::lookup(context, stm->getName()->str);
+	if (clType && clType->isClass())
+		static_cast<SClassType*>(clType)->setAllocator(value->str());
+}
+
 SFunction Builder::getFuncPrototype(CodeContext& context, Token* name, SFunctionType* funcType, NAttributeList* attrs)
 {
 	auto funcName = name->str;
@@ -302,7 +355,7 @@ SFunctionType* Builder::getFuncType(CodeContext& context, NDataType* retType, ND
 	return (returnType && valid)? SType::getFunction(context, returnType, args) : nullptr;
 }
 
-bool Builder::addMembers(NVariableDeclGroup* group, vector<pair<string, SType*> >& structVector, set<string>& memberNames, CodeContext& context)
+bool Builder::addMembers(NVariableDeclGroup* group, vector<pair<string, SType*> >& structVector, set<string>& memberNames, CodeContext& context, bool isUnion)
 {
 	auto stype = CGNDataType::run(context, group->getType());
 	if (!stype) {
@@ -322,15 +375,48 @@ bool Builder::addMembers(NVariableDeclGroup* group, vector<pair<string, SType*>
 			valid = false;
 			continue;
 		}
-		structVector.push_back(make_pair(name, stype));
+		auto memberType = stype;
+		if (var->getBitWidth()) {
+			memberType = getBitField(context, stype, var->getBitWidth(), isUnion);
+			if (!memberType) {
+				valid = false;
+				continue;
+			}
+		}
+		structVector.push_back(make_pair(name, memberType));
 	}
 	return valid;
 }
 
+SType* Builder::getBitField(CodeContext& context, SType* stype, NIntConst* bitWidth, bool isUnion)
+{
+	if (isUnion) {
+		context.addError("bit-fields not valid for a union", *bitWidth);
+		return nullptr;
+	} else if (!stype->isInteger() || stype->isAtomic()) {
+		context.addError("bit-field requires an integer type, found " + stype->str(&context), *bitWidth);
+		return nullptr;
+	}
+	auto width = CGNInt::run(context, bitWidth).getZExtValue();
+	if (width < 1 || width > stype->size()) {
+		context.addError("bit-field width must be between 1 and " + to_string(stype->size()), *bitWidth);
+		return nullptr;
+	}
+	return SType::getBitField(context, stype, width);
+}
+
+bool Builder::isPrototype(const RValue& value)
+{
+	if (!value.isFunction())
+		return false;
+	auto func = static_cast<const SFunction&>(value);
+	return func.size() == 0;
+}
+
 bool Builder::isDeclared(CodeContext& context, Token* name)
 {
 	auto utype = SUserType::lookup(context, name->str);
-	if (utype) {
+	if (utype && !(utype->isOpaque() && context.isCurrGeneric(name->str))) {
 		context.addError("type with name " + name->str + " already declared", name);
 		return true;
 	}
@@ -355,34 +441,77 @@ void Builder::validateAttrList(CodeContext& context, NAttributeList* attrs)
 	}
 }
 
-void Builder::CreateStruct(CodeContext& context, NStructDeclaration::CreateType ctype, Token* name, NVariableDeclGroupList* list)
+void Builder::CreateStruct(CodeContext& context, NStructDeclaration::CreateType ctype, Token* name, NVariableDeclGroupList* list, NAttributeList* attrs)
 {
 	if (isDeclared(context, name))
 		return;
 
+	SStructLayout layout;
+	if (getStructLayout(context, ctype, attrs, layout))
+		return;
+
 	auto structName = name->str;
 	vector<pair<string, SType*> > structVars;
 	set<string> memberNames;
 	bool valid = true;
 	if (list) {
 		for (auto item : *list)
-			valid &= addMembers(item, structVars, memberNames, context);
+			valid &= addMembers(item, structVars, memberNames, context, ctype == NStructDeclaration::CreateType::UNION);
 	}
 	if (valid) {
 		switch (ctype) {
 		case NStructDeclaration::CreateType::STRUCT:
-			SUserType::createStruct(context, structName, structVars);
+			SUserType::createStruct(context, structName, structVars, layout);
 			return;
 		case NStructDeclaration::CreateType::UNION:
 			SUserType::createUnion(context, structName, structVars);
 			return;
 		case NStructDeclaration::CreateType::CLASS:
-			SUserType::createClass(context, structName, structVars);
+			SUserType::createClass(context, structName, structVars, layout);
 			return;
 		}
 	}
 }
 
+bool Builder::getStructLayout(CodeContext& context, NStructDeclaration::CreateType ctype, NAttributeList* attrs, SStructLayout& layout)
+{
+	auto packed = NAttributeList::find(attrs, "packed");
+	auto reorder = NAttributeList::find(attrs, "reorder");
+	auto align = NAttributeList::find(attrs, "align");
+	if (ctype == NStructDeclaration::CreateType::UNION) {
+		for (auto attr : {packed, reorder, align}) {
+			if (attr) {
+				context.addError(attr->getName()->str + " attribute not valid for a union", *attr);
+				return true;
+			}
+		}
+		return false;
+	}
+	layout.packed = packed != nullptr;
+	layout.reorder = reorder != nullptr;
+	if (!align)
+		return false;
+
+	auto value = NAttrValueList::find(align->getValues(), 0);
+	if (!value) {
+		context.addError("align attribute requires value", *align);
+		return true;
+	} else if (packed) {
+		context.addError("align attribute can't be used with packed", *align);
+		return true;
+	}
+	auto str = value->str();
+	uint64_t size = 0;
+	if (!str.empty() && str.size() < 7 && str.find_first_not_of("0123456789") == string::npos)
+		size = stoul(str);
+	if (!size || (size & (size - 1))) {
+		context.addError("align attribute requires a power of 2: " + str, *value);
+		return true;
+	}
+	layout.align = size;
+	return false;
+}
+
 void Builder::CreateEnum(CodeContext& context, NEnumDeclaration* stm)
 {
 	if (isDeclared(context, stm->getName()))
@@ -461,19 +590,26 @@ void Builder::CreateAlias(CodeContext& context, NAliasDeclaration* stm)
 
 void Builder::CreateGlobalVar(CodeContext& context, NGlobalVariableDecl* stm, bool declaration)
 {
-	if (stm->getInitExp() && !stm->getInitExp()->isConstant()) {
+	validateAttrList(context, stm->getAttrs());
+
+	auto initExp = stm->getInitExp();
+	auto evaluate = isEvaluated(initExp);
+	if (initExp && !initExp->isConstant() && !evaluate) {
 		context.addError("global variables only support constant value initializer", stm->getName());
 		return;
 	}
-	auto initValue = CGNExpression::run(context, stm->getInitExp());
+	auto initValue = evaluate? RValue() : CGNExpression::run(context, initExp);
 	auto varType = CGNDataType::run(context, stm->getType());
 
 	if (!varType) {
 		return;
 	} else if (varType->isAuto()) {
-		if (!stm->getInitExp()) { // auto type requires initialization
+		if (!initExp) { // auto type requires initialization
 			context.addError("auto variable type requires initialization", *stm->getType());
 			return;
+		} else if (evaluate) {
+			context.addError("auto variable type requires a constant initializer", *stm->getType());
+			return;
 		} else if (!initValue) {
 			return;
 		}
@@ -500,27 +636,357 @@ void Builder::CreateGlobalVar(CodeContext& context, NGlobalVariableDecl* stm, bo
 		return;
 	}
 
+	auto tlsMode = GlobalValue::NotThreadLocal;
+	if (getThreadLocalMode(context, stm->getAttrs(), tlsMode))
+		return;
+
 	auto var = new GlobalVariable(*context.getModule(), *varType, false, GlobalValue::ExternalLinkage, declaration? nullptr : (Constant*) initValue.value(), name);
+	var->setThreadLocalMode(tlsMode);
+	if (auto align = SType::customAlign(context, varType))
+		var->setAlignment(align);
 	context.storeGlobalSymbol({var, varType}, name);
+
+	if (evaluate && !declaration)
+		evalInitializer(context, var, initExp, varType);
 }
 
-void Builder::LoadImport(CodeContext& context, NImportStm* stm)
+bool Builder::isEvaluated(NExpression* initExp)
 {
-	auto filename = Util::relative(context.currFile().parent_path() / stm->getName()->str);
-	if (context.fileLoaded(filename)) {
+	return initExp && initExp->id() == NodeId::NFunctionCall;
+}
+
+void Builder::evalInitializer(CodeContext& context, GlobalVariable* var, NExpression* initExp, SType* varType)
+{
+	// the call is generated in a temporary function, so its arguments
+	// are cast as usual, which is then interpreted and removed
+	auto funcType = SType::getFunction(context, varType, {});
+	auto thunk = Function::Create(*funcType, GlobalValue::InternalLinkage, "", context.getModule());
+	context.startFuncBlock(SFunction::create(context, thunk, funcType, nullptr));
+	auto value = CGNExpression::run(context, initExp);
+	auto valid = value && !Inst::CastTo(context, *initExp, value, varType);
+	if (valid)
+		ReturnInst::Create(context, value, context);
+	context.endFuncBlock();
+
+	if (!valid) {
+		thunk->eraseFromParent();
 		return;
-	} else if (!exists(filename)) {
-		context.addError("unable to import file: " + stm->getName()->str, *stm);
+	}
+	// a function prototyped before its body waits for the rest of the module
+	CodeContext::DeferredGlobal global = {var, thunk, *static_cast<Token*>(*initExp)};
+	if (ConstEval::isDefined(context, thunk))
+		evalDeferred(context, global);
+	else
+		context.queueGlobal(global);
+}
+
+void Builder::evalDeferred(CodeContext& context, CodeContext::DeferredGlobal& global)
+{
+	auto result = ConstEval(context, &global.token).run(global.thunk);
+	global.thunk->eraseFromParent();
+	if (result)
+		global.var->setInitializer(result);
+}
+
+void Builder::DefineGlobals(CodeContext& context)
+{
+	CodeContext::DeferredGlobal global;
+	while (context.nextGlobal(global))
+		evalDeferred(context, global);
+}
+
+bool Builder::getThreadLocalMode(CodeContext& context, NAttributeList* attrs, GlobalValue::ThreadLocalMode& mode)
+{
+	auto attr = NAttributeList::find(attrs, "thread_local");
+	if (!attr)
+		return false;
+
+	auto value = NAttrValueList::find(attr->getValues(), 0);
+	auto model = value? value->str() : "general_dynamic";
+	if (model == "general_dynamic") {
+		mode = GlobalValue::GeneralDynamicTLSModel;
+	} else if (model == "local_dynamic") {
+		mode = GlobalValue::LocalDynamicTLSModel;
+	} else if (model == "initial_exec") {
+		mode = GlobalValue::InitialExecTLSModel;
+	} else if (model == "local_exec") {
+		mode = GlobalValue::LocalExecTLSModel;
+	} else {
+		context.addError("invalid thread_local model: " + model, *value);
+		return true;
+	}
+	return false;
+}
+
+void Builder::DefineGlobalVar(CodeContext& context, NGlobalVariableDecl* stm)
+{
+	// the declaration pass already validated the initializer
+	auto initExp = stm->getInitExp();
+	if (!initExp || !(initExp->isConstant() || isEvaluated(initExp)))
+		return;
+	auto sym = context.loadSymbolGlobal(stm->getName()->str);
+	auto var = sym? dyn_cast<GlobalVariable>(sym.value()) : nullptr;
+	if (!var || var->hasInitializer())
+		return;
+
+	if (isEvaluated(initExp)) {
+		evalInitializer(context, var, initExp, sym.stype());
 		return;
 	}
+	auto initValue = CGNExpression::run(context, initExp);
+	if (!initValue)
+		return;
+	else if (initValue.isNullPtr())
+		Inst::CastTo(context, *initExp, initValue, sym.stype());
+	var->setInitializer((Constant*) initValue.value());
+}
+
+Parser* Builder::parseImport(CodeContext& context, const path& filename, unique_ptr<Parser>& owner)
+{
+	auto cache = context.getImportCache();
+	auto parser = cache? cache->get(filename) : nullptr;
+	if (parser)
+		return parser;
+
+	owner.reset(new Parser(filename.string()));
+	PhaseTimer::Scope phase("parse");
+	if (owner->parse()) {
+		auto err = owner->getError();
+		context.addError(err.str, &err);
+		return nullptr;
+	}
+	parser = owner.get();
+	if (cache)
+		cache->put(filename, std::move(owner));
+	return parser;
+}
+
+void Builder::streamImport(CodeContext& context, const path& filename, bool define)
+{
 	Parser parser(filename.string());
+	parser.setDeclHandler([&](NStatement* stm) {
+		PhaseTimer::Scope phase("codegen");
+		CGNImportStm::run(context, stm, define);
+		if (!context.keepGeneric(stm))
+			delete stm;
+	});
+
+	context.pushFile(filename);
+	PhaseTimer::Scope phase("parse");
 	if (parser.parse()) {
 		auto err = parser.getError();
 		context.addError(err.str, &err);
+	}
+	context.popFile();
+}
+
+void Builder::LoadImport(CodeContext& context, NImportStm* stm)
+{
+	auto filename = Util::relative(context.currFile().parent_path() / stm->getName()->str);
+	if (context.fileLoaded(filename)) {
+		return;
+	} else if (!exists(filename)) {
+		context.addError("unable to import file: " + stm->getName()->str, *stm);
+		return;
+	} else if (context.isStreaming() && !context.getImportCache()) {
+		streamImport(context, filename, false);
 		return;
 	}
+	unique_ptr<Parser> owner;
+	auto parser = parseImport(context, filename, owner);
+	if (!parser)
+		return;
 
 	context.pushFile(filename);
-	CGNImportStm::run(context, parser.getRoot());
+	CGNImportStm::run(context, parser->getRoot());
 	context.popFile();
+
+	// generic instances outlive an uncached parse
+	if (owner) {
+		for (auto& item : *parser->getRoot()) {
+			if (context.keepGeneric(item))
+				item = nullptr;
+		}
+	}
+}
+
+void Builder::DefineImports(CodeContext& context)
+{
+	auto mainFile = context.currFile();
+	// defined in the order they're imported, same as the declarations
+	auto files = context.getFileOrder();
+	for (auto& filename : files) {
+		if (filename == mainFile)
+			continue;
+		if (context.isStreaming() && !context.getImportCache()) {
+			streamImport(context, filename, true);
+			continue;
+		}
+		unique_ptr<Parser> owner;
+		auto parser = parseImport(context, filename, owner);
+		if (!parser)
+			continue;
+
+		context.pushFile(filename);
+		CGNImportStm::run(context, parser->getRoot(), true);
+		context.popFile();
+	}
+}
+
+// instances are generated from the generic's AST under their own name
+class GenericRename
+{
+	Token* token;
+	string name;
+
+public:
+	GenericRename(Token* token, const string& instName)
+	: token(token), name(token->str)
+	{
+		token->str = instName;
+	}
+
+	~GenericRename()
+	{
+		token->str = name;
+	}
+};
+
+void Builder::CreateGeneric(CodeContext& context, NDeclaration* stm, NDataTypeList* params)
+{
+	auto name = stm->getName();
+	set<string> names;
+	for (auto param : *params) {
+		auto paramName = static_cast<NUserType*>(param)->getName();
+		if (!names.insert(paramName->str).second) {
+			context.addError("generic parameter " + paramName->str + " already declared", paramName);
+			return;
+		}
+	}
+	if (isDeclared(context, name)) {
+		return;
+	} else if (context.loadSymbolGlobal(name->str) || !context.addGeneric(name->str, stm, params)) {
+		context.addError("generic " + name->str + " already declared", name);
+	}
+}
+
+CodeContext::GenericDecl* Builder::getGenericArgs(CodeContext& context, Token* name, NDataTypeList* args, CodeContext::GenericArgs& bound, string& instName)
+{
+	auto generic = context.getGeneric(name->str);
+	if (!generic) {
+		context.addError(name->str + " is not a generic", name);
+		return nullptr;
+	} else if (generic->params->size() != args->size()) {
+		context.addError("generic " + name->str + " requires " + to_string(generic->params->size()) + " type arguments", name);
+		return nullptr;
+	}
+
+	instName = name->str + "<";
+	for (int i = 0; i < args->size(); i++) {
+		auto arg = args->at(i);
+		auto type = CGNDataType::run(context, arg);
+		if (!type) {
+			return nullptr;
+		} else if (type->isAuto()) {
+			context.addError("generic argument can't be auto", *arg);
+			return nullptr;
+		}
+		bound[static_cast<NUserType*>(generic->params->at(i))->getName()->str] = type;
+		instName += (i? "," : "") + type->str(&context);
+	}
+	instName += ">";
+	return generic;
+}
+
+SType* Builder::CreateGenericType(CodeContext& context, NUserType* type)
+{
+	CodeContext::GenericArgs args;
+	string instName;
+	auto generic = getGenericArgs(context, type->getName(), type->getGenericArgs(), args, instName);
+	if (!generic) {
+		return nullptr;
+	}
+	auto decl = static_cast<NDeclaration*>(generic->decl);
+	if (decl->id() == NodeId::NFunctionDeclaration) {
+		context.addError(type->getName()->str + " is a generic function, not a type", *type);
+		return nullptr;
+	}
+
+	auto ty = SUserType::lookup(context, instName);
+	if (ty)
+		return ty;
+	if (!context.pushGenericArgs(instName, args)) {
+		context.addError("recursive generic instance " + instName, *type);
+		return nullptr;
+	}
+
+	// declared first so that members can point to the instance
+	if (decl->id() == NodeId::NClassDeclaration)
+		SUserType::declareStruct(context, instName, true);
+	else if (static_cast<NStructDeclaration*>(decl)->getType() == NStructDeclaration::CreateType::STRUCT)
+		SUserType::declareStruct(context, instName, false);
+
+	// struct instances are complete, class functions are defined later
+	auto currClass = context.getClass();
+	{
+		GenericRename rename(decl->getName(), instName);
+		CGNImportStm::run(context, decl, false);
+	}
+	context.setClass(currClass);
+	context.popGenericArgs();
+
+	if (decl->id() == NodeId::NClassDeclaration)
+		context.queueGeneric({decl, instName, args});
+	return SUserType::lookup(context, instName);
+}
+
+SFunction Builder::CreateGenericFunction(CodeContext& context, NFunctionCall* call)
+{
+	CodeContext::GenericArgs args;
+	string instName;
+	auto generic = getGenericArgs(context, call->getName(), call->getGenericArgs(), args, instName);
+	if (!generic) {
+		return SFunction();
+	} else if (generic->decl->id() != NodeId::NFunctionDeclaration) {
+		context.addError(call->getName()->str + " is a generic type, not a function", *call);
+		return SFunction();
+	}
+
+	auto sym = context.loadSymbolGlobal(instName);
+	if (sym)
+		return static_cast<SFunction&>(sym);
+
+	// only the prototype, the body may call further instances
+	auto decl = static_cast<NFunctionDeclaration*>(generic->decl);
+	Token name(*decl->getName());
+	name.str = instName;
+	if (!context.pushGenericArgs(instName, args)) {
+		context.addError("recursive generic instance " + instName, *call);
+		return SFunction();
+	}
+	auto func = CreateFunction(context, &name, decl->getRType(), decl->getParams(), nullptr, decl->getAttrs());
+	context.popGenericArgs();
+
+	if (func)
+		context.queueGeneric({decl, instName, args});
+	return func;
+}
+
+void Builder::DefineGenerics(CodeContext& context)
+{
+	CodeContext::GenericInstance instance;
+	while (context.nextGeneric(instance)) {
+		auto decl = static_cast<NDeclaration*>(instance.decl);
+		context.pushGenericArgs(instance.name, instance.args);
+		if (decl->id() == NodeId::NFunctionDeclaration) {
+			auto func = static_cast<NFunctionDeclaration*>(decl);
+			Token name(*func->getName());
+			name.str = instance.name;
+			CreateFunction(context, &name, func->getRType(), func->getParams(), func->getBody(), func->getAttrs());
+		} else {
+			GenericRename rename(decl->getName(), instance.name);
+			CGNImportStm::run(context, decl, true);
+		}
+		context.popGenericArgs();
+	}
 }
@@ -18,16 +18,42 @@
 #ifndef __BUILDER_H__
 #define __BUILDER_H__
 
+#include <memory>
+#include <boost/filesystem.hpp>
+#include "CodeContext.h"
+
+class Parser;
+
 class Builder
 {
+	static Parser* parseImport(CodeContext& context, const boost::filesystem::path& filename, unique_ptr<Parser>& owner);
+
+	static void streamImport(CodeContext& context, const boost::filesystem::path& filename, bool define);
+
 	static SFunctionType* getFuncType(CodeContext& context, NDataType* rtype, NParameterList* params);
 
-	static bool addMembers(NVariableDeclGroup* group, vector<pair<string, SType*> >& structVector, set<string>& memberNames, CodeContext& context);
+	static bool addMembers(NVariableDeclGroup* group, vector<pair<string, SType*> >& structVector, set<string>& memberNames, CodeContext& context, bool isUnion);
+
+	static SType* getBitField(CodeContext& context, SType* stype, NIntConst* bitWidth, bool isUnion);
+
+	static bool isPrototype(const RValue& value);
 
 	static bool isDeclared(CodeContext& context, Token* name);
 
 	static void validateAttrList(CodeContext& context, NAttributeList* attrs);
 
+	static bool isEvaluated(NExpression* initExp);
+
+	static void evalInitializer(CodeContext& context, GlobalVariable* var, NExpression* initExp, SType* varType);
+
+	static void evalDeferred(CodeContext& context, CodeContext::DeferredGlobal& global);
+
+	static bool getStructLayout(CodeContext& context, NStructDeclaration::CreateType ctype, NAttributeList* attrs, SStructLayout& layout);
+
+	static bool getThreadLocalMode(CodeContext& context, NAttributeList* attrs, GlobalValue::ThreadLocalMode& mode);
+
+	static CodeContext::GenericDecl* getGenericArgs(CodeContext& context, Token* name, NDataTypeList* args, CodeContext::GenericArgs& bound, string& instName);
+
 public:
 	static SFunctionType* getFuncType(CodeContext& context, NDataType* retType, NDataTypeList* params);
 
@@ -35,15 +61,18 @@ public:
 
 	static SFunction CreateFunction(CodeContext& context, Token* name, NDataType* rtype, NParameterList* params, NStatementList* body, NAttributeList* attrs = nullptr);
 
-	static void CreateClassFunction(CodeContext& context, NClassFunctionDecl* stm, bool prototype);
+	// body replaces the declaration's body when given
+	static void CreateClassFunction(CodeContext& context, NClassFunctionDecl* stm, bool prototype, NStatementList* body = nullptr);
 
 	static void CreateClassConstructor(CodeContext& context, NClassConstructor* stm, bool prototype);
 
 	static void CreateClassDestructor(CodeContext& context, NClassDestructor* stm, bool prototype);
 
+	static void CreateClassAllocator(CodeContext& context, NClassDeclaration* stm);
+
 	static void CreateClass(CodeContext& context, NClassDeclaration* stm, function<void(int)> visitor);
 
-	static void CreateStruct(CodeContext& context, NStructDeclaration::CreateType ctype, Token* name, NVariableDeclGroupList* list);
+	static void CreateStruct(CodeContext& context, NStructDeclaration::CreateType ctype, Token* name, NVariableDeclGroupList* list, NAttributeList* attrs = nullptr);
 
 	static void CreateEnum(CodeContext& context, NEnumDeclaration* stm);
 
@@ -51,7 +80,21 @@ public:
 
 	static void CreateGlobalVar(CodeContext& context, NGlobalVariableDecl* stm, bool declaration);
 
+	static void DefineGlobalVar(CodeContext& context, NGlobalVariableDecl* stm);
+
+	static void DefineGlobals(CodeContext& context);
+
 	static void LoadImport(CodeContext& context, NImportStm* stm);
+
+	static void DefineImports(CodeContext& context);
+
+	static void CreateGeneric(CodeContext& context, NDeclaration* stm, NDataTypeList* params);
+
+	static SType* CreateGenericType(CodeContext& context, NUserType* type);
+
+	static SFunction CreateGenericFunction(CodeContext& context, NFunctionCall* call);
+
+	static void DefineGenerics(CodeContext& context);
 };
 
 #endif
@@ -28,6 +28,7 @@ SType* CGNDataType::visit(NDataType* type)
 {
 	switch (type->id()) {
 	VISIT_CASE_RETURN(NArrayType, type)
+	VISIT_CASE_RETURN(NAtomicType, type)
 	VISIT_CASE_RETURN(NBaseType, type)
 	VISIT_CASE_RETURN(NConstType, type)
 	VISIT_CASE_RETURN(NFuncPointerType, type)
@@ -81,6 +82,22 @@ SType* CGNDataType::visitNConstType(NConstType* type)
 	return SType::getConst(context, visit(type->getType()));
 }
 
+SType* CGNDataType::visitNAtomicType(NAtomicType* type)
+{
+	return getAtomicType(type, visit(type->getType()));
+}
+
+SType* CGNDataType::getAtomicType(NAtomicType* type, SType* stype)
+{
+	if (!stype) {
+		return nullptr;
+	} else if ((!stype->isInteger() && !stype->isPointer()) || stype->isBool()) {
+		context.addError("atomic requires an integer or pointer type", *type);
+		return nullptr;
+	}
+	return SType::getAtomic(context, stype);
+}
+
 SType* CGNDataType::visitNThisType(NThisType* type)
 {
 	auto cl = context.getClass();
@@ -147,10 +164,19 @@ SType* CGNDataType::visitNVecType(NVecType* type)
 
 SType* CGNDataType::visitNUserType(NUserType* type)
 {
+	if (type->getGenericArgs())
+		return Builder::CreateGenericType(context, type);
+
 	auto typeName = type->getName()->str;
+	auto bound = context.getGenericArg(typeName);
+	if (bound)
+		return bound;
 	auto ty = SUserType::lookup(context, typeName);
 	if (!ty) {
-		context.addError(typeName + " type not declared", *type);
+		if (context.getGeneric(typeName))
+			context.addError("generic " + typeName + " requires type arguments", *type);
+		else
+			context.addError(typeName + " type not declared", *type);
 		return nullptr;
 	}
 	return ty->isAlias()? ty->subType() : ty;
@@ -179,6 +205,7 @@ SType* CGNDataTypeNew::visit(NDataType* type)
 {
 	switch (type->id()) {
 	VISIT_CASE_RETURN(NArrayType, type)
+	VISIT_CASE_RETURN(NAtomicType, type)
 	VISIT_CASE_RETURN(NBaseType, type)
 	VISIT_CASE_RETURN(NConstType, type)
 	VISIT_CASE_RETURN(NFuncPointerType, type)
@@ -231,6 +258,11 @@ SType* CGNDataTypeNew::visitNConstType(NConstType* type)
 	return SType::getConst(context, visit(type->getType()));
 }
 
+SType* CGNDataTypeNew::visitNAtomicType(NAtomicType* type)
+{
+	return getAtomicType(type, visit(type->getType()));
+}
+
 SType* CGNDataTypeNew::visitNThisType(NThisType* type)
 {
 	auto ty = CGNDataType::visitNThisType(type);
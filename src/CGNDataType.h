@@ -31,6 +31,8 @@ protected:
 
 	SType* visitNConstType(NConstType* type);
 
+	SType* visitNAtomicType(NAtomicType* type);
+
 	SType* visitNThisType(NThisType* type);
 
 	SType* visitNArrayType(NArrayType* type);
@@ -47,6 +49,8 @@ protected:
 
 	SType* getArrayType(NArrayType* type);
 
+	SType* getAtomicType(NAtomicType* type, SType* stype);
+
 public:
 
 	static SType* run(CodeContext& context, NDataType* type)
@@ -67,6 +71,8 @@ class CGNDataTypeNew : public CGNDataType
 
 	SType* visitNConstType(NConstType* type);
 
+	SType* visitNAtomicType(NAtomicType* type);
+
 	SType* visitNThisType(NThisType* type);
 
 	SType* visitNArrayType(NArrayType* type);
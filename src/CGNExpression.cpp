@@ -75,6 +75,10 @@ RValue CGNExpression::visitNVariable(NVariable* nVar)
 RValue CGNExpression::visitNAddressOf(NAddressOf* nVar)
 {
 	auto var = CGNVariable::run(context, nVar);
+	if (var && var.stype()->isBitField()) {
+		context.addError("cannot take address of bit-field", *nVar);
+		return RValue();
+	}
 	return var? RValue(var, SType::getPointer(context, var.stype())) : var;
 }
 
@@ -112,11 +116,13 @@ RValue CGNExpression::visitNAssignment(NAssignment* exp)
 		return RValue();
 
 	if (exp->getOp() != '=' && exp->getOp() != ParserBase::TT_DQ_MARK) {
+		if (lhsVar.stype()->isAtomic())
+			return atomicAssign(exp, lhsVar, rhsExp);
 		auto lhsLocal = Inst::Load(context, lhsVar);
 		rhsExp = Inst::BinaryOp(exp->getOp(), *exp, lhsLocal, rhsExp, context);
 	}
 	Inst::CastTo(context, *exp->getRhs(), rhsExp, lhsVar.stype());
-	new StoreInst(rhsExp, lhsVar, context);
+	Inst::Store(context, rhsExp, lhsVar);
 
 	if (exp->getOp() == ParserBase::TT_DQ_MARK) {
 		BranchInst::Create(endBlock, context);
@@ -126,6 +132,30 @@ RValue CGNExpression::visitNAssignment(NAssignment* exp)
 	return rhsExp;
 }
 
+RValue CGNExpression::atomicAssign(NAssignment* exp, RValue lhsVar, RValue rhsExp)
+{
+	AtomicRMWInst::BinOp op;
+	switch (exp->getOp()) {
+	case '+': op = AtomicRMWInst::Add; break;
+	case '-': op = AtomicRMWInst::Sub; break;
+	case '&': op = AtomicRMWInst::And; break;
+	case '|': op = AtomicRMWInst::Or;  break;
+	case '^': op = AtomicRMWInst::Xor; break;
+	default:
+		context.addError("operator not supported for atomic assignment", *exp);
+		return RValue();
+	}
+	auto type = SType::getNonAtomic(context, lhsVar.stype());
+	if (!type->isInteger()) {
+		context.addError("atomic assignment requires an integer type", *exp);
+		return RValue();
+	} else if (Inst::CastTo(context, *exp->getRhs(), rhsExp, type)) {
+		return RValue();
+	}
+	auto oldVal = Inst::AtomicRMW(context, op, lhsVar, rhsExp);
+	return Inst::BinaryOp(exp->getOp(), *exp, oldVal, rhsExp, context);
+}
+
 RValue CGNExpression::visitNTernaryOperator(NTernaryOperator* exp)
 {
 	auto condExp = visit(exp->getCondition());
@@ -164,22 +194,46 @@ RValue CGNExpression::visitNTernaryOperator(NTernaryOperator* exp)
 	return retVal;
 }
 
-RValue CGNExpression::visitNNewExpression(NNewExpression* exp)
+RValue CGNExpression::allocate(NNewExpression* exp, SType* type, RValue size)
 {
-	auto funcVal = context.loadSymbol("malloc");
-	if (!funcVal) {
-		vector<SType*> args;
-		args.push_back(SType::getInt(context, 64));
-		auto retType = SType::getPointer(context, SType::getInt(context, 8));
-		auto funcType = SType::getFunction(context, retType, args);
-		Token mallocName("malloc");
-
-		funcVal = Builder::getFuncPrototype(context, &mallocName, funcType);
-	} else if (!funcVal.isFunction()) {
-		context.addError("Compiler Error: malloc not function", *exp);
-		return RValue();
+	// new (arena) type: call the arena's allocate function
+	if (exp->getArena()) {
+		auto arena = CGNVariable::run(context, exp->getArena());
+		if (!arena)
+			return RValue();
+		arena = RValue(arena, SType::getPointer(context, arena.stype()));
+		while (arena.stype()->subType()->isPointer())
+			arena = Inst::Deref(context, arena);
+
+		auto arenaType = arena.stype()->subType();
+		if (!arenaType->isClass()) {
+			context.addError("new arena requires class or class pointer", *exp);
+			return RValue();
+		}
+		return Inst::CallAllocator(context, static_cast<SClassType*>(arenaType), arena, "allocate", size, *exp);
+	}
+
+	// class with an allocator attribute
+	auto alloc = Inst::LoadAllocator(context, type, *exp);
+	if (alloc) {
+		auto arena = RValue::getUndef(SType::getPointer(context, alloc));
+		return Inst::CallAllocator(context, alloc, arena, "allocate", size, *exp);
 	}
 
+	auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
+	auto func = Inst::LoadFunction(context, "malloc", bytePtr, {SType::getInt(context, 64)}, *exp);
+	if (!func)
+		return RValue();
+
+	vector<Value*> exp_list;
+	exp_list.push_back(size);
+
+	auto call = CallInst::Create(func, exp_list, "", context);
+	return RValue(call, func.returnTy());
+}
+
+RValue CGNExpression::visitNNewExpression(NNewExpression* exp)
+{
 	RValue size;
 	auto nType = CGNDataTypeNew::run(context, exp->getType(), size);
 	if (!nType) {
@@ -189,12 +243,9 @@ RValue CGNExpression::visitNNewExpression(NNewExpression* exp)
 		return RValue();
 	}
 
-	vector<Value*> exp_list;
-	exp_list.push_back(size);
-
-	auto func = static_cast<SFunction&>(funcVal);
-	auto call = CallInst::Create(func, exp_list, "", context);
-	auto ptr = RValue(call, func.returnTy());
+	auto ptr = allocate(exp, nType, size);
+	if (!ptr)
+		return RValue();
 	auto ptrType = SType::getPointer(context, nType);
 	auto rPtr = RValue(new BitCastInst(ptr, *ptrType, "", context), ptrType);
 
@@ -300,6 +351,14 @@ RValue CGNExpression::visitNUnaryMathOperator(NUnaryMathOperator* exp)
 
 RValue CGNExpression::visitNFunctionCall(NFunctionCall* exp)
 {
+	vector<Value*> exp_list;
+	if (exp->getGenericArgs()) {
+		auto func = Builder::CreateGenericFunction(context, exp);
+		if (!func)
+			return RValue();
+		return Inst::CallFunction(context, func, exp->getName(), exp->getArguments(), exp_list);
+	}
+
 	auto funcName = exp->getName()->str;
 	auto sym = context.loadSymbol(funcName);
 	if (!sym) {
@@ -329,7 +388,6 @@ RValue CGNExpression::visitNFunctionCall(NFunctionCall* exp)
 	}
 
 	auto func = static_cast<SFunction&>(deSym);
-	vector<Value*> exp_list;
 	return Inst::CallFunction(context, func, exp->getName(), exp->getArguments(), exp_list);
 }
 
@@ -341,7 +399,9 @@ RValue CGNExpression::visitNMemberFunctionCall(NMemberFunctionCall* exp)
 RValue CGNExpression::visitNIncrement(NIncrement* exp)
 {
 	auto varPtr = CGNVariable::run(context, exp->getVar());
-	auto varVal = Inst::Load(context, varPtr);
+	auto isAtomic = varPtr && varPtr.stype()->isAtomic();
+	// atomic variables are read by the atomicrmw instead
+	auto varVal = isAtomic? RValue(varPtr.value(), SType::getNonAtomic(context, varPtr.stype())) : Inst::Load(context, varPtr);
 	if (!varVal)
 		return RValue();
 
@@ -360,9 +420,19 @@ RValue CGNExpression::visitNIncrement(NIncrement* exp)
 		return RValue();
 	}
 	auto incType = type->isPointer()? SType::getInt(context, 32) : type;
+	auto incVal = RValue::getNumVal(context, incType, exp->getOp() == ParserBase::TT_INC? 1:-1);
+
+	if (isAtomic) {
+		if (type->isPointer()) {
+			context.addError("Increment/Decrement invalid for atomic pointer", *exp);
+			return RValue();
+		}
+		auto oldVal = Inst::AtomicRMW(context, AtomicRMWInst::Add, varPtr, incVal);
+		return exp->postfix()? oldVal : Inst::BinaryOp(exp->getOp(), *exp, oldVal, incVal, context);
+	}
 
-	auto result = Inst::BinaryOp(exp->getOp(), *exp, varVal, RValue::getNumVal(context, incType, exp->getOp() == ParserBase::TT_INC? 1:-1), context);
-	new StoreInst(result, varPtr, context);
+	auto result = Inst::BinaryOp(exp->getOp(), *exp, varVal, incVal, context);
+	Inst::Store(context, result, varPtr);
 
 	return exp->postfix()? varVal : RValue(result, type);
 }
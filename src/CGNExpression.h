@@ -30,8 +30,12 @@ class CGNExpression
 
 	RValue visitNAssignment(NAssignment*);
 
+	RValue atomicAssign(NAssignment* exp, RValue lhsVar, RValue rhsExp);
+
 	RValue visitNTernaryOperator(NTernaryOperator*);
 
+	RValue allocate(NNewExpression* exp, SType* type, RValue size);
+
 	RValue visitNNewExpression(NNewExpression*);
 
 	RValue visitNExprVariable(NExprVariable*);
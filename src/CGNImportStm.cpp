@@ -54,68 +54,96 @@ void CGNImportStm::visitNVariableDeclGroup(NVariableDeclGroup* stm)
 {
 	for (auto variable : *stm->getVars()) {
 		variable->setDataType(stm->getType());
+		variable->setAttrs(stm->getAttrs());
 		visit(variable);
 	}
 }
 
 void CGNImportStm::visitNGlobalVariableDecl(NGlobalVariableDecl* stm)
 {
-	Builder::CreateGlobalVar(context, stm, true);
+	if (define)
+		Builder::DefineGlobalVar(context, stm);
+	else
+		Builder::CreateGlobalVar(context, stm, true);
 }
 
 void CGNImportStm::visitNAliasDeclaration(NAliasDeclaration* stm)
 {
+	if (define)
+		return;
 	Builder::CreateAlias(context, stm);
 }
 
 void CGNImportStm::visitNStructDeclaration(NStructDeclaration* stm)
 {
+	if (define) {
+		return;
+	} else if (stm->getGenericParams() && !context.inGeneric()) {
+		Builder::CreateGeneric(context, stm, stm->getGenericParams());
+		return;
+	}
 	NVariableDeclGroupList empty;
 	auto vars = NAttributeList::find(stm->getAttrs(), "opaque")? &empty : stm->getVars();
 
-	Builder::CreateStruct(context, stm->getType(), stm->getName(), vars);
+	Builder::CreateStruct(context, stm->getType(), stm->getName(), vars, stm->getAttrs());
 }
 
 void CGNImportStm::visitNEnumDeclaration(NEnumDeclaration* stm)
 {
+	if (define)
+		return;
 	Builder::CreateEnum(context, stm);
 }
 
 void CGNImportStm::visitNFunctionDeclaration(NFunctionDeclaration* stm)
 {
-	Builder::CreateFunction(context, stm->getName(), stm->getRType(), stm->getParams(), nullptr, stm->getAttrs());
+	if (stm->getGenericParams()) {
+		if (!define)
+			Builder::CreateGeneric(context, stm, stm->getGenericParams());
+		return;
+	}
+	Builder::CreateFunction(context, stm->getName(), stm->getRType(), stm->getParams(), define? stm->getBody() : nullptr, stm->getAttrs());
 }
 
 void CGNImportStm::visitNClassStructDecl(NClassStructDecl* stm)
 {
+	if (define)
+		return;
 	auto cl = stm->getClass();
 	auto stToken = cl->getName();
 	auto stType = NStructDeclaration::CreateType::CLASS;
 	NVariableDeclGroupList empty;
 	auto vars = NAttributeList::find(cl->getAttrs(), "opaque")? &empty : stm->getVarList();
 
-	Builder::CreateStruct(context, stType, stToken, vars);
+	Builder::CreateStruct(context, stType, stToken, vars, cl->getAttrs());
 }
 
 void CGNImportStm::visitNClassFunctionDecl(NClassFunctionDecl* stm)
 {
-	Builder::CreateClassFunction(context, stm, true);
+	Builder::CreateClassFunction(context, stm, !define);
 }
 
 void CGNImportStm::visitNClassConstructor(NClassConstructor* stm)
 {
-	Builder::CreateClassConstructor(context, stm, true);
+	Builder::CreateClassConstructor(context, stm, !define);
 }
 
 void CGNImportStm::visitNClassDestructor(NClassDestructor* stm)
 {
-	Builder::CreateClassDestructor(context, stm, true);
+	Builder::CreateClassDestructor(context, stm, !define);
 }
 
 void CGNImportStm::visitNClassDeclaration(NClassDeclaration* stm)
 {
+	// instances are created by Builder::CreateGenericType
+	if (stm->getGenericParams() && !context.inGeneric()) {
+		if (!define)
+			Builder::CreateGeneric(context, stm, stm->getGenericParams());
+		return;
+	}
 	Builder::CreateClass(context, stm, [=](int structIdx){
 		visit(stm->getMembers()->at(structIdx));
+		Builder::CreateClassAllocator(context, stm);
 		context.setClass(static_cast<SClassType*>(SUserType::lookup(context, stm->getName()->str)));
 
 		for (int i = 0; i < stm->getMembers()->size(); i++) {
@@ -20,9 +20,10 @@
 class CGNImportStm
 {
 	CodeContext& context;
+	bool define;
 
-	explicit CGNImportStm(CodeContext& context)
-	: context(context) {}
+	CGNImportStm(CodeContext& context, bool define)
+	: context(context), define(define) {}
 
 	void visitNImportStm(NImportStm* stm);
 
@@ -56,9 +57,15 @@ class CGNImportStm
 
 public:
 
-	static void run(CodeContext& context, NStatementList* list)
+	static void run(CodeContext& context, NStatement* stm, bool define = false)
 	{
-		CGNImportStm runner(context);
+		CGNImportStm runner(context, define);
+		return runner.visit(stm);
+	}
+
+	static void run(CodeContext& context, NStatementList* list, bool define = false)
+	{
+		CGNImportStm runner(context, define);
 		return runner.visit(list);
 	}
 };
@@ -31,6 +31,7 @@ void CGNStatement::visit(NStatement* stm)
 {
 	switch (stm->id()) {
 	VISIT_CASE(NAliasDeclaration, stm)
+	VISIT_CASE(NAwaitStatement, stm)
 	VISIT_CASE(NClassConstructor, stm)
 	VISIT_CASE(NClassDeclaration, stm)
 	VISIT_CASE(NClassDestructor, stm)
@@ -57,6 +58,7 @@ void CGNStatement::visit(NStatement* stm)
 	VISIT_CASE(NVariableDecl, stm)
 	VISIT_CASE(NVariableDeclGroup, stm)
 	VISIT_CASE(NWhileStatement, stm)
+	VISIT_CASE(NYieldStatement, stm)
 	default:
 		context.addError("NodeId::" + to_string(static_cast<int>(stm->id())) + " unrecognized in CGNStatement", nullptr);
 	}
@@ -86,12 +88,18 @@ void CGNStatement::visitNParameter(NParameter* stm)
 #else
 	auto stackAlloc = new AllocaInst(*stype, "", context);
 #endif
+	if (auto align = SType::customAlign(context, stype))
+		stackAlloc->setAlignment(align);
 	new StoreInst(storedValue, stackAlloc, context);
 	context.storeLocalSymbol({stackAlloc, stype}, stm->getName()->str);
 }
 
 void CGNStatement::visitNVariableDecl(NVariableDecl* stm)
 {
+	if (stm->getBitWidth()) {
+		context.addError("bit-fields are only valid for struct members", *stm->getBitWidth());
+		return;
+	}
 	auto initValue = CGNExpression::run(context, stm->getInitExp());
 	auto varType = CGNDataType::run(context, stm->getType());
 
@@ -119,10 +127,13 @@ void CGNStatement::visitNVariableDecl(NVariableDecl* stm)
 	}
 
 #if LLVM_VERSION_MAJOR >= 5
-	auto var = RValue(new AllocaInst(*varType, 0, name, context), varType);
+	auto stackAlloc = new AllocaInst(*varType, 0, name, context);
 #else
-	auto var = RValue(new AllocaInst(*varType, name, context), varType);
+	auto stackAlloc = new AllocaInst(*varType, name, context);
 #endif
+	if (auto align = SType::customAlign(context, varType))
+		stackAlloc->setAlignment(align);
+	auto var = RValue(stackAlloc, varType);
 	context.storeLocalSymbol(var, name);
 
 	Inst::InitVariable(context, var, stm->getName(), stm->getInitList(), initValue);
@@ -132,6 +143,7 @@ void CGNStatement::visitNVariableDeclGroup(NVariableDeclGroup* stm)
 {
 	for (auto variable : *stm->getVars()) {
 		variable->setDataType(stm->getType());
+		variable->setAttrs(stm->getAttrs());
 		visit(variable);
 	}
 }
@@ -148,7 +160,11 @@ void CGNStatement::visitNAliasDeclaration(NAliasDeclaration* stm)
 
 void CGNStatement::visitNStructDeclaration(NStructDeclaration* stm)
 {
-	Builder::CreateStruct(context, stm->getType(), stm->getName(), stm->getVars());
+	if (stm->getGenericParams()) {
+		Builder::CreateGeneric(context, stm, stm->getGenericParams());
+		return;
+	}
+	Builder::CreateStruct(context, stm->getType(), stm->getName(), stm->getVars(), stm->getAttrs());
 }
 
 void CGNStatement::visitNEnumDeclaration(NEnumDeclaration* stm)
@@ -158,6 +174,10 @@ void CGNStatement::visitNEnumDeclaration(NEnumDeclaration* stm)
 
 void CGNStatement::visitNFunctionDeclaration(NFunctionDeclaration* stm)
 {
+	if (stm->getGenericParams()) {
+		Builder::CreateGeneric(context, stm, stm->getGenericParams());
+		return;
+	}
 	Builder::CreateFunction(context, stm->getName(), stm->getRType(), stm->getParams(), stm->getBody(), stm->getAttrs());
 }
 
@@ -166,7 +186,7 @@ void CGNStatement::visitNClassStructDecl(NClassStructDecl* stm)
 	auto cl = stm->getClass();
 	auto stToken = cl->getName();
 	auto stType = NStructDeclaration::CreateType::CLASS;
-	Builder::CreateStruct(context, stType, stToken, stm->getVarList());
+	Builder::CreateStruct(context, stType, stToken, stm->getVarList(), cl->getAttrs());
 }
 
 void CGNStatement::visitNClassFunctionDecl(NClassFunctionDecl* stm)
@@ -203,8 +223,13 @@ void CGNStatement::visitNMemberInitializer(NMemberInitializer* stm)
 
 void CGNStatement::visitNClassDeclaration(NClassDeclaration* stm)
 {
+	if (stm->getGenericParams()) {
+		Builder::CreateGeneric(context, stm, stm->getGenericParams());
+		return;
+	}
 	Builder::CreateClass(context, stm, [=](int structIdx){
 		visit(stm->getMembers()->at(structIdx));
+		Builder::CreateClassAllocator(context, stm);
 		context.setClass(static_cast<SClassType*>(SUserType::lookup(context, stm->getName()->str)));
 
 		for (int i = 0; i < stm->getMembers()->size(); i++) {
@@ -221,7 +246,18 @@ void CGNStatement::visitNReturnStatement(NReturnStatement* stm)
 	auto func = context.currFunction();
 	auto funcReturn = func.returnTy();
 
-	if (funcReturn->isVoid()) {
+	if (context.inNestedFunction()) {
+		context.addError("return invalid inside a parallel for", *stm);
+		return;
+	} else if (context.inCoroutine()) {
+		if (stm->getValue()) {
+			context.addError("async function " + func.name().str() + " can't return a value", *stm->getValue());
+			return;
+		}
+		BranchInst::Create(context.getCoroutine().finalBlock, context);
+		context.pushBlock(context.createBlock());
+		return;
+	} else if (funcReturn->isVoid()) {
 		if (stm->getValue()) {
 			context.addError("function " + func.name().str() + " declared void, but non-void return found", *stm->getValue());
 			return;
@@ -237,6 +273,30 @@ void CGNStatement::visitNReturnStatement(NReturnStatement* stm)
 	context.pushBlock(context.createBlock());
 }
 
+void CGNStatement::visitNYieldStatement(NYieldStatement* stm)
+{
+	if (!context.inCoroutine()) {
+		context.addError("yield only valid inside an async function", *stm);
+		return;
+	}
+	auto resumeBlock = context.createBlock();
+	Inst::CoroutineSuspend(context, resumeBlock);
+	context.pushBlock(resumeBlock);
+}
+
+void CGNStatement::visitNAwaitStatement(NAwaitStatement* stm)
+{
+	if (!context.inCoroutine()) {
+		context.addError("await only valid inside an async function", *stm);
+		return;
+	}
+	auto handle = CGNExpression::run(context, stm->getExp());
+	auto handleType = SType::getPointer(context, SType::getVoid(context));
+	if (Inst::CastTo(context, *stm->getExp(), handle, handleType))
+		return;
+	Inst::CoroutineAwait(context, handle);
+}
+
 void CGNStatement::visitNLoopStatement(NLoopStatement* stm)
 {
 	auto bodyBlock = context.createContinueBlock();
@@ -329,6 +389,10 @@ void CGNStatement::visitNSwitchStatement(NSwitchStatement* stm)
 
 void CGNStatement::visitNForStatement(NForStatement* stm)
 {
+	auto parallel = NAttributeList::find(stm->getAttrs(), "parallel");
+	if (parallel)
+		return parallelFor(stm, parallel);
+
 	auto condBlock = context.createBlock();
 	auto bodyBlock = context.createRedoBlock();
 	auto postBlock = context.createContinueBlock();
@@ -355,6 +419,153 @@ void CGNStatement::visitNForStatement(NForStatement* stm)
 	context.popLoopBranchBlocks(BranchType::BREAK | BranchType::CONTINUE | BranchType::REDO);
 }
 
+void CGNStatement::parallelFor(NForStatement* stm, NAttribute* attr)
+{
+	// only loops of the form: for (T i = start; i < end; i++)
+	auto preStm = stm->getPreStm();
+	auto group = preStm->size() == 1 && preStm->at(0)->id() == NodeId::NVariableDeclGroup?
+		static_cast<NVariableDeclGroup*>(preStm->at(0)) : nullptr;
+	auto var = group && group->getVars()->size() == 1? group->getVars()->at(0) : nullptr;
+	auto cond = stm->getCond() && stm->getCond()->id() == NodeId::NCompareOperator?
+		static_cast<NCompareOperator*>(stm->getCond()) : nullptr;
+	auto post = stm->getPostExp()->size() == 1 && stm->getPostExp()->at(0)->id() == NodeId::NIncrement?
+		static_cast<NIncrement*>(stm->getPostExp()->at(0)) : nullptr;
+
+	auto isVar = [=](NExpression* exp) {
+		return exp->id() == NodeId::NBaseVariable && static_cast<NBaseVariable*>(exp)->getName()->str == var->getName()->str;
+	};
+	if (!var || !var->getInitExp() || !cond || (cond->getOp() != '<' && cond->getOp() != ParserBase::TT_LEQ)
+	|| !isVar(cond->getLhs()) || !post || post->getOp() != ParserBase::TT_INC || !isVar(post->getVar())) {
+		context.addError("parallel for requires the form: for (T i = start; i < end; i++)", *attr);
+		return;
+	}
+
+	int64_t chunk = 0;
+	auto chunkVal = NAttrValueList::find(attr->getValues(), 0);
+	if (chunkVal) {
+		char* end;
+		chunk = strtoll(chunkVal->str().c_str(), &end, 10);
+		if (*end || chunk <= 0) {
+			context.addError("invalid parallel chunk size: " + chunkVal->str(), *chunkVal);
+			return;
+		}
+	}
+
+	// the bounds are evaluated once, before any iteration runs
+	auto startVal = CGNExpression::run(context, var->getInitExp());
+	auto endVal = CGNExpression::run(context, cond->getRhs());
+	auto varType = CGNDataType::run(context, group->getType());
+	if (!startVal || !endVal || !varType) {
+		return;
+	} else if (varType->isAuto()) {
+		varType = startVal.stype();
+	}
+	if (!varType->isInteger() || varType->isBool()) {
+		context.addError("parallel for requires an integer loop variable", var->getName());
+		return;
+	}
+
+	auto i64 = SType::getInt(context, 64);
+	auto i8Ptr = SType::getPointer(context, SType::getInt(context, 8));
+	if (Inst::CastTo(context, *var->getInitExp(), startVal, varType) || Inst::CastTo(context, *cond->getRhs(), endVal, varType)
+	|| Inst::CastTo(context, *var->getInitExp(), startVal, i64) || Inst::CastTo(context, *cond->getRhs(), endVal, i64))
+		return;
+
+	// the runtime is told how to compare the bounds instead of getting end + 1,
+	// which would wrap when the bound is the type's max: 1 = inclusive, 2 = unsigned
+	int rangeFlags = (cond->getOp() == ParserBase::TT_LEQ? 1 : 0) | (varType->isUnsigned()? 2 : 0);
+
+	// every visible local is passed to the body by reference
+	auto captured = context.getLocalSymbols();
+	vector<Type*> envTypes;
+	for (auto& item : captured)
+		envTypes.push_back(item.second.value()->getType());
+	auto envType = StructType::get(context, envTypes);
+	auto zero = RValue::getZero(context, SType::getInt(context, 32));
+
+	// outline the loop body into: void body(@void env, int64 first, int64 last)
+	auto bodyType = SType::getFunction(context, SType::getVoid(context), {i8Ptr, i64, i64});
+	auto func = Function::Create(*bodyType, GlobalValue::InternalLinkage, context.currFunction().name() + ".parallel", context.getModule());
+	auto args = func->arg_begin();
+	Value* envArg = &*args++;
+	Value* firstArg = &*args++;
+	Value* lastArg = &*args;
+	envArg->setName("env");
+	firstArg->setName("first");
+	lastArg->setName("last");
+
+	context.pushFuncBlock(SFunction::create(context, func, bodyType, nullptr));
+
+	auto envPtr = new BitCastInst(envArg, PointerType::getUnqual(envType), "", context);
+	int idx = 0;
+	for (auto& item : captured) {
+		Value* idxs[] = {zero, RValue::getNumVal(context, SType::getInt(context, 32), idx++)};
+		auto ptr = GetElementPtrInst::Create(nullptr, envPtr, idxs, "", context);
+		context.storeLocalSymbol({new LoadInst(ptr, "", context), item.second.stype()}, item.first);
+	}
+
+	RValue firstVal(firstArg, i64), lastVal(lastArg, i64);
+	Inst::CastTo(context, *var->getInitExp(), firstVal, varType);
+	Inst::CastTo(context, *cond->getRhs(), lastVal, varType);
+
+#if LLVM_VERSION_MAJOR >= 5
+	auto loopVar = RValue(new AllocaInst(*varType, 0, var->getName()->str, context), varType);
+#else
+	auto loopVar = RValue(new AllocaInst(*varType, var->getName()->str, context), varType);
+#endif
+	new StoreInst(firstVal, loopVar, context);
+	context.storeLocalSymbol(loopVar, var->getName()->str);
+
+	auto condBlock = context.createBlock();
+	auto bodyBlock = context.createRedoBlock();
+	auto postBlock = context.createContinueBlock();
+	auto incBlock = context.createBlock();
+	auto endBlock = context.createBlock();
+	BranchInst::Create(condBlock, context);
+
+	context.pushBlock(condBlock);
+	auto cmp = Inst::Cmp(ParserBase::TT_LEQ, *cond, Inst::Load(context, loopVar), lastVal, context);
+	BranchInst::Create(bodyBlock, endBlock, cmp, context);
+
+	context.pushBlock(bodyBlock);
+	visit(stm->getBody());
+	BranchInst::Create(postBlock, context);
+
+	// stop on the last value so the increment can't wrap past it
+	context.pushBlock(postBlock);
+	auto isLast = Inst::Cmp(ParserBase::TT_EQ, *cond, Inst::Load(context, loopVar), lastVal, context);
+	BranchInst::Create(endBlock, incBlock, isLast, context);
+
+	context.pushBlock(incBlock);
+	CGNExpression::run(context, stm->getPostExp());
+	BranchInst::Create(condBlock, context);
+
+	context.pushBlock(endBlock);
+	ReturnInst::Create(context, context);
+	context.popLoopBranchBlocks(BranchType::CONTINUE | BranchType::REDO);
+	context.popFuncBlock();
+
+	// pack the captured locals and run the chunks; returns once all are done
+#if LLVM_VERSION_MAJOR >= 5
+	auto env = new AllocaInst(envType, 0, "", context);
+#else
+	auto env = new AllocaInst(envType, "", context);
+#endif
+	idx = 0;
+	for (auto& item : captured) {
+		Value* idxs[] = {zero, RValue::getNumVal(context, SType::getInt(context, 32), idx++)};
+		auto ptr = GetElementPtrInst::Create(nullptr, env, idxs, "", context);
+		new StoreInst(item.second, ptr, context);
+	}
+	auto envVal = new BitCastInst(env, *i8Ptr, "", context);
+
+	auto i32 = SType::getInt(context, 32);
+	auto runType = SType::getFunction(context, SType::getVoid(context), {SType::getPointer(context, bodyType), i8Ptr, i64, i64, i64, i32});
+	auto runFunc = context.getModule()->getOrInsertFunction("saphyr_parallel_for", *runType);
+	vector<Value*> runArgs = {func, envVal, startVal, endVal, RValue::getNumVal(context, i64, chunk), RValue::getNumVal(context, i32, rangeFlags)};
+	CallInst::Create(runFunc, runArgs, "", context);
+}
+
 void CGNStatement::visitNIfStatement(NIfStatement* stm)
 {
 	auto ifBlock = context.createBlock();
@@ -454,21 +665,6 @@ error:
 
 void CGNStatement::visitNDeleteStatement(NDeleteStatement* stm)
 {
-	auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
-	auto func = context.loadSymbol("free");
-	if (!func) {
-		vector<SType*> args;
-		args.push_back(bytePtr);
-		auto retType = SType::getVoid(context);
-		auto funcType = SType::getFunction(context, retType, args);
-		Token freeName("free");
-
-		func = Builder::getFuncPrototype(context, &freeName, funcType);
-	} else if (!func.isFunction()) {
-		context.addError("Compiler Error: free not function", *stm->getVar());
-		return;
-	}
-
 	auto ptr = CGNExpression::run(context, stm->getVar());
 	if (!ptr) {
 		return;
@@ -477,13 +673,25 @@ void CGNStatement::visitNDeleteStatement(NDeleteStatement* stm)
 		return;
 	}
 
+	auto alloc = Inst::LoadAllocator(context, ptr.stype()->subType(), *stm->getVar());
 	if (ptr.stype()->subType()->isClass())
 		Inst::CallDestructor(context, ptr, *stm->getVar());
 
+	if (alloc) {
+		auto arena = RValue::getUndef(SType::getPointer(context, alloc));
+		Inst::CallAllocator(context, alloc, arena, "deallocate", ptr, *stm->getVar());
+		return;
+	}
+
+	auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
+	auto func = Inst::LoadFunction(context, "free", SType::getVoid(context), {bytePtr}, *stm->getVar());
+	if (!func)
+		return;
+
 	vector<Value*> exp_list;
 	exp_list.push_back(new BitCastInst(ptr, *bytePtr, "", context));
 
-	CallInst::Create(static_cast<SFunction&>(func), exp_list, "", context);
+	CallInst::Create(func, exp_list, "", context);
 }
 
 void CGNStatement::visitNDestructorCall(NDestructorCall* stm)
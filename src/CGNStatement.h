@@ -56,6 +56,10 @@ class CGNStatement
 
 	void visitNReturnStatement(NReturnStatement* stm);
 
+	void visitNYieldStatement(NYieldStatement* stm);
+
+	void visitNAwaitStatement(NAwaitStatement* stm);
+
 	void visitNLoopStatement(NLoopStatement* stm);
 
 	void visitNWhileStatement(NWhileStatement* stm);
@@ -64,6 +68,8 @@ class CGNStatement
 
 	void visitNForStatement(NForStatement* stm);
 
+	void parallelFor(NForStatement* stm, NAttribute* attr);
+
 	void visitNIfStatement(NIfStatement* stm);
 
 	void visitNLabelStatement(NLabelStatement* stm);
@@ -110,7 +110,11 @@ RValue CGNVariable::visitNArrayVariable(NArrayVariable* nArrVar)
 RValue CGNVariable::visitNArrowOperator(NArrowOperator* exp)
 {
 	auto name = exp->getName()->str;
-	if (name == "size") {
+	if (exp->getType() == NArrowOperator::ATOMIC) {
+		return Inst::AtomicFence(context, exp);
+	} else if (exp->getExpArgs()) {
+		return Inst::AtomicOp(context, exp);
+	} else if (name == "size") {
 		return Inst::SizeOf(context, exp);
 	} else if (name == "as") {
 		return Inst::CastAs(context, exp);
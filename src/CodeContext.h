@@ -32,6 +32,9 @@
 using namespace boost::program_options;
 using namespace boost::filesystem;
 
+class ImportCache;
+class NDataType;
+
 enum BranchType { BREAK = 1, CONTINUE = 1 << 1, REDO = 1 << 2 };
 
 struct LabelBlock
@@ -62,11 +65,18 @@ public:
 		auto varData = table.find(name);
 		return varData != table.end()? varData->second : RValue();
 	}
+
+	const map<string, RValue>& getSymbols() const
+	{
+		return table;
+	}
 };
 
 class SymbolTable
 {
 	ScopeTable globalTable;
+
+protected:
 	vector<ScopeTable> localTable;
 
 public:
@@ -95,6 +105,17 @@ public:
 		localTable.clear();
 	}
 
+	// all visible local symbols, inner scopes hiding outer ones
+	map<string, RValue> getLocalSymbols() const
+	{
+		map<string, RValue> symbols;
+		for (auto it = localTable.rbegin(); it != localTable.rend(); it++) {
+			for (auto& item : it->getSymbols())
+				symbols.insert(item);
+		}
+		return symbols;
+	}
+
 	RValue loadSymbolLocal(const string& name) const
 	{
 		for (auto it = localTable.rbegin(); it != localTable.rend(); it++) {
@@ -135,11 +156,70 @@ class CodeContext : public SymbolTable
 	typedef vector<llvm::BasicBlock*> BlockVector;
 	typedef BlockVector::iterator block_iterator;
 
+public:
+	// blocks and values shared by the suspend points of an async function
+	struct CoroutineState
+	{
+		Value* id = nullptr;
+		Value* handle = nullptr;
+		BasicBlock* finalBlock = nullptr;
+		BasicBlock* cleanupBlock = nullptr;
+		BasicBlock* suspendBlock = nullptr;
+	};
+
+	typedef map<string, SType*> GenericArgs;
+
+	// a generic declaration, kept until the end of the module
+	struct GenericDecl
+	{
+		Node* decl;
+		NodeList<NDataType>* params;
+	};
+
+	// an instance whose function bodies are generated by Builder::DefineGenerics
+	struct GenericInstance
+	{
+		Node* decl;
+		string name;
+		GenericArgs args;
+	};
+
+	// a global whose initializer calls a #[constexpr] function without a body
+	// yet; the call is kept in thunk until Builder::DefineGlobals evaluates it
+	struct DeferredGlobal
+	{
+		GlobalVariable* var;
+		Function* thunk;
+		Token token;
+	};
+
+private:
+
+	struct FunctionState
+	{
+		BlockVector funcBlocks;
+		BlockVector continueBlocks;
+		BlockVector breakBlocks;
+		BlockVector redoBlocks;
+		map<string, LabelBlockPtr> labelBlocks;
+		vector<ScopeTable> localTable;
+		SFunction currFunc;
+		CoroutineState coroutine;
+	};
+
 	BlockVector funcBlocks;
 	BlockVector continueBlocks;
 	BlockVector breakBlocks;
 	BlockVector redoBlocks;
 	map<string, LabelBlockPtr> labelBlocks;
+	vector<FunctionState> funcStack;
+	CoroutineState coroutine;
+
+	map<string, GenericDecl> generics;
+	list<unique_ptr<Node>> genericOwner;
+	vector<pair<string, GenericArgs>> genericStack;
+	vector<GenericInstance> genericQueue;
+	vector<DeferredGlobal> globalQueue;
 
 	vector<pair<Token,string>> errors;
 	list<unique_ptr<NAttributeList>> attrs;
@@ -149,7 +229,10 @@ class CodeContext : public SymbolTable
 	SFunction currFunc;
 	SClassType* currClass;
 	set<path> allFiles;
+	vector<path> fileOrder;
 	vector<path> filesStack;
+	ImportCache* importCache;
+	bool streaming;
 
 	void validateFunction()
 	{
@@ -167,7 +250,7 @@ class CodeContext : public SymbolTable
 
 public:
 	explicit CodeContext(Module* module)
-	: module(module), typeManager(module), currClass(nullptr)
+	: module(module), typeManager(module), currClass(nullptr), importCache(nullptr), streaming(false)
 	{
 	}
 
@@ -194,7 +277,8 @@ public:
 	void pushFile(const path& filename)
 	{
 		filesStack.push_back(filename);
-		allFiles.insert(filename);
+		if (allFiles.insert(filename).second)
+			fileOrder.push_back(filename);
 	}
 
 	void popFile()
@@ -207,6 +291,37 @@ public:
 		return allFiles.find(filename) != allFiles.end();
 	}
 
+	const set<path>& getFiles() const
+	{
+		return allFiles;
+	}
+
+	// the files in the order their imports were first loaded
+	const vector<path>& getFileOrder() const
+	{
+		return fileOrder;
+	}
+
+	ImportCache* getImportCache() const
+	{
+		return importCache;
+	}
+
+	void setImportCache(ImportCache* cache)
+	{
+		importCache = cache;
+	}
+
+	bool isStreaming() const
+	{
+		return streaming;
+	}
+
+	void setStreaming(bool stream)
+	{
+		streaming = stream;
+	}
+
 	SFunction currFunction() const
 	{
 		return currFunc;
@@ -214,8 +329,9 @@ public:
 
 	NAttributeList* storeAttr(NAttributeList* list)
 	{
+		// copied so the AST can be freed or reused by another compile
 		if (list) {
-			list = list->move<NAttributeList>(false);
+			list = list->copy();
 			attrs.push_back(unique_ptr<NAttributeList>(list));
 		}
 		return list;
@@ -264,6 +380,145 @@ public:
 		labelBlocks.clear();
 
 		currFunc = SFunction();
+		coroutine = CoroutineState();
+	}
+
+	// start generating a function nested inside the current one (such as
+	// an outlined loop body), saving the current function's state
+	void pushFuncBlock(SFunction function)
+	{
+		FunctionState state;
+		swap(state.funcBlocks, funcBlocks);
+		swap(state.continueBlocks, continueBlocks);
+		swap(state.breakBlocks, breakBlocks);
+		swap(state.redoBlocks, redoBlocks);
+		swap(state.labelBlocks, labelBlocks);
+		swap(state.localTable, localTable);
+		state.currFunc = currFunc;
+		state.coroutine = coroutine;
+		funcStack.push_back(move(state));
+		coroutine = CoroutineState();
+
+		startFuncBlock(function);
+	}
+
+	void popFuncBlock()
+	{
+		endFuncBlock();
+
+		auto& state = funcStack.back();
+		swap(state.funcBlocks, funcBlocks);
+		swap(state.continueBlocks, continueBlocks);
+		swap(state.breakBlocks, breakBlocks);
+		swap(state.redoBlocks, redoBlocks);
+		swap(state.labelBlocks, labelBlocks);
+		swap(state.localTable, localTable);
+		currFunc = state.currFunc;
+		coroutine = state.coroutine;
+		funcStack.pop_back();
+	}
+
+	bool inNestedFunction() const
+	{
+		return !funcStack.empty();
+	}
+
+	CoroutineState& getCoroutine()
+	{
+		return coroutine;
+	}
+
+	bool inCoroutine() const
+	{
+		return coroutine.handle;
+	}
+
+	bool addGeneric(const string& name, Node* decl, NodeList<NDataType>* params)
+	{
+		return generics.insert({name, {decl, params}}).second;
+	}
+
+	GenericDecl* getGeneric(const string& name)
+	{
+		auto it = generics.find(name);
+		return it != generics.end()? &it->second : nullptr;
+	}
+
+	// takes ownership of a generic declaration whose AST would otherwise
+	// be freed (streamed or imported files); returns false if not generic
+	bool keepGeneric(Node* decl)
+	{
+		for (auto& item : generics) {
+			if (item.second.decl == decl) {
+				genericOwner.push_back(unique_ptr<Node>(decl));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// returns false if name is already being instantiated
+	bool pushGenericArgs(const string& name, GenericArgs args)
+	{
+		for (auto& item : genericStack) {
+			if (item.first == name)
+				return false;
+		}
+		genericStack.push_back({name, move(args)});
+		return true;
+	}
+
+	void popGenericArgs()
+	{
+		genericStack.pop_back();
+	}
+
+	SType* getGenericArg(const string& name) const
+	{
+		if (genericStack.empty())
+			return nullptr;
+		auto& args = genericStack.back().second;
+		auto it = args.find(name);
+		return it != args.end()? it->second : nullptr;
+	}
+
+	bool inGeneric() const
+	{
+		return !genericStack.empty();
+	}
+
+	// true while the members of the named instance are created
+	bool isCurrGeneric(const string& name) const
+	{
+		return !genericStack.empty() && genericStack.back().first == name;
+	}
+
+	void queueGeneric(GenericInstance instance)
+	{
+		genericQueue.push_back(move(instance));
+	}
+
+	bool nextGeneric(GenericInstance& instance)
+	{
+		if (genericQueue.empty())
+			return false;
+		instance = move(genericQueue.front());
+		genericQueue.erase(genericQueue.begin());
+		return true;
+	}
+
+	void queueGlobal(DeferredGlobal global)
+	{
+		globalQueue.push_back(move(global));
+	}
+
+	bool nextGlobal(DeferredGlobal& global)
+	{
+		if (globalQueue.empty())
+			return false;
+		global = move(globalQueue.front());
+		globalQueue.erase(globalQueue.begin());
+		return true;
 	}
 
 	void pushBlock(BasicBlock* block)
@@ -0,0 +1,311 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/MD5.h>
+
+#include "CompileCache.h"
+#include "SourceManager.h"
+
+typedef boost::system::error_code fs_error;
+
+// an output directory or a manifest
+struct CacheEntry
+{
+	path file;
+	time_t time;
+	uintmax_t size;
+};
+
+static string digest(llvm::MD5& hash)
+{
+	llvm::MD5::MD5Result result;
+	llvm::SmallString<32> str;
+
+	hash.final(result);
+	llvm::MD5::stringifyResult(result, str);
+	return str.str().str();
+}
+
+static uintmax_t entrySize(const path& entry)
+{
+	fs_error err;
+	uintmax_t size = 0;
+	for (directory_iterator it(entry, err), end; !err && it != end; it.increment(err)) {
+		auto fileSize = file_size(it->path(), err);
+		size += err? 0 : fileSize;
+	}
+	return size;
+}
+
+// manifests are counted with the entries, so the ones for keys that no
+// longer match (edited inputs, a rebuilt compiler) age out the same way
+static bool isEntry(const directory_entry& item, uintmax_t& size)
+{
+	fs_error err;
+	if (is_directory(item.status())) {
+		size = entrySize(item.path());
+		return true;
+	} else if (item.path().extension() == ".manifest") {
+		size = file_size(item.path(), err);
+		size = err? 0 : size;
+		return true;
+	}
+	return false;
+}
+
+static bool atomicCopy(const path& from, const path& to)
+{
+	fs_error err;
+	path temp = to.string() + ".tmp" + to_string(getpid());
+
+	copy_file(from, temp, copy_option::overwrite_if_exists, err);
+	if (!err)
+		rename(temp, to, err);
+	if (err)
+		remove(temp, err);
+	return !err;
+}
+
+string CompileCache::hashFile(const path& file)
+{
+	if (!exists(file))
+		return string();
+
+	// shares the mapping the lexer reads from
+	auto source = SourceManager::get(file.string());
+
+	llvm::MD5 hash;
+	hash.update(llvm::StringRef(source->data(), source->size()));
+	return digest(hash);
+}
+
+path CompileCache::manifestPath() const
+{
+	return dir / (mainKey + ".manifest");
+}
+
+string CompileCache::fullKey(const vector<path>& imports) const
+{
+	llvm::MD5 hash;
+	hash.update(mainKey);
+	for (auto& file : imports) {
+		hash.update(file.string());
+		hash.update(hashFile(file));
+	}
+	return digest(hash);
+}
+
+bool CompileCache::readManifest(vector<path>& imports) const
+{
+	std::ifstream in(manifestPath().string());
+	if (!in)
+		return false;
+
+	string line;
+	while (getline(in, line)) {
+		if (!line.empty())
+			imports.push_back(line);
+	}
+	return true;
+}
+
+void CompileCache::writeManifest(const vector<path>& imports) const
+{
+	auto temp = manifestPath().string() + ".tmp" + to_string(getpid());
+	{
+		std::ofstream out(temp);
+		for (auto& file : imports)
+			out << file.string() << "\n";
+	}
+	fs_error err;
+	rename(temp, manifestPath(), err);
+}
+
+static void readCounts(int fd, uintmax_t& hits, uintmax_t& misses)
+{
+	char buffer[64];
+	auto len = pread(fd, buffer, sizeof(buffer), 0);
+	if (len > 0)
+		std::istringstream(string(buffer, len)) >> hits >> misses;
+}
+
+void CompileCache::readStats(uintmax_t& hits, uintmax_t& misses) const
+{
+	hits = misses = 0;
+	auto fd = open((dir / "stats").c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	flock(fd, LOCK_SH);
+	readCounts(fd, hits, misses);
+	close(fd);
+}
+
+void CompileCache::addStats(bool hit) const
+{
+	auto fd = open((dir / "stats").c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return;
+
+	// parallel compiles share the counters, so hold the lock across the update
+	flock(fd, LOCK_EX);
+	uintmax_t hits = 0, misses = 0;
+	readCounts(fd, hits, misses);
+	(hit? hits : misses)++;
+
+	// the counts only grow, so the new line always covers the old one
+	auto line = to_string(hits) + " " + to_string(misses) + "\n";
+	if (pwrite(fd, line.data(), line.size(), 0) != static_cast<ssize_t>(line.size()))
+		cout << "unable to update compile cache stats" << endl;
+	close(fd);
+}
+
+void CompileCache::evict() const
+{
+	fs_error err;
+	vector<CacheEntry> entries;
+	uintmax_t total = 0;
+
+	for (directory_iterator it(dir, err), end; !err && it != end; it.increment(err)) {
+		uintmax_t size;
+		if (!isEntry(*it, size))
+			continue;
+		auto time = last_write_time(it->path(), err);
+		entries.push_back({it->path(), err? 0 : time, size});
+		total += size;
+	}
+	if (total <= maxSize)
+		return;
+
+	// least recently used entries first
+	sort(entries.begin(), entries.end(), [](const CacheEntry& a, const CacheEntry& b){
+		return a.time < b.time;
+	});
+	for (auto& entry : entries) {
+		remove_all(entry.file, err);
+		total -= entry.size;
+		if (total <= maxSize)
+			break;
+	}
+}
+
+bool CompileCache::restore(const path& file, const vector<string>& outputFiles, const variables_map& config)
+{
+	fs_error err;
+	input = absolute(file);
+	outputs = outputFiles;
+
+	create_directories(dir, err);
+	if (err)
+		return false;
+
+	llvm::MD5 hash;
+	hash.update(LLVM_VERSION_STRING);
+	hash.update(input.string());
+	hash.update(hashFile(input));
+
+	// a rebuilt compiler invalidates the cache
+	path compiler("/proc/self/exe");
+	auto compilerSize = file_size(compiler, err);
+	if (!err)
+		hash.update(to_string(compilerSize) + ":" + to_string(last_write_time(compiler, err)));
+
+	for (auto& opt : config) {
+		if (opt.first == "input" || opt.first.compare(0, 6, "cache-") == 0)
+			continue;
+		auto& value = opt.second.value();
+		hash.update(opt.first + "=");
+		if (value.type() == typeid(int))
+			hash.update(to_string(boost::any_cast<int>(value)));
+		else if (value.type() == typeid(string))
+			hash.update(boost::any_cast<string>(value));
+	}
+	mainKey = digest(hash);
+
+	vector<path> imports;
+	if (!readManifest(imports)) {
+		addStats(false);
+		return false;
+	}
+
+	auto entry = dir / fullKey(imports);
+	for (auto& out : outputs) {
+		if (!exists(entry / path(out).filename(), err)) {
+			addStats(false);
+			return false;
+		}
+	}
+	for (auto& out : outputs) {
+		if (!atomicCopy(entry / path(out).filename(), out)) {
+			addStats(false);
+			return false;
+		}
+	}
+	last_write_time(entry, time(nullptr), err);
+	last_write_time(manifestPath(), time(nullptr), err);
+	addStats(true);
+	return true;
+}
+
+void CompileCache::store(const set<path>& files)
+{
+	if (mainKey.empty())
+		return;
+
+	vector<path> imports;
+	for (auto& file : files) {
+		auto absFile = absolute(file);
+		if (absFile != input)
+			imports.push_back(absFile);
+	}
+	writeManifest(imports);
+
+	fs_error err;
+	auto entry = dir / fullKey(imports);
+	create_directories(entry, err);
+	if (err)
+		return;
+	for (auto& out : outputs)
+		atomicCopy(out, entry / path(out).filename());
+	last_write_time(entry, time(nullptr), err);
+
+	evict();
+}
+
+void CompileCache::printStats(ostream& out) const
+{
+	fs_error err;
+	uintmax_t hits, misses, size = 0;
+
+	readStats(hits, misses);
+	for (directory_iterator it(dir, err), end; !err && it != end; it.increment(err)) {
+		uintmax_t entry;
+		if (isEntry(*it, entry))
+			size += entry;
+	}
+	out << "cache hits: " << hits << endl
+		<< "cache misses: " << misses << endl
+		<< "cache size: " << size << " / " << maxSize << " bytes" << endl;
+}
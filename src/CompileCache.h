@@ -0,0 +1,76 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __COMPILE_CACHE_H__
+#define __COMPILE_CACHE_H__
+
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+
+using namespace std;
+using namespace boost::filesystem;
+using namespace boost::program_options;
+
+/**
+ * Caches the output files of a compile, keyed on the content of the input
+ * file, the content of every file it transitively imports, the compiler
+ * binary and the codegen options.
+ *
+ * The import set is only known after a compile, so it's recorded in a
+ * manifest keyed on the input file alone. A lookup reads the manifest and
+ * hashes the listed imports to find the entry holding the outputs.
+ * Entries and manifests are evicted least recently used first once the
+ * cache grows past its maximum size.
+ */
+class CompileCache
+{
+	path dir;
+	uintmax_t maxSize;
+	path input;
+	vector<string> outputs;
+	string mainKey;
+
+	static string hashFile(const path& file);
+
+	path manifestPath() const;
+
+	string fullKey(const vector<path>& imports) const;
+
+	bool readManifest(vector<path>& imports) const;
+
+	void writeManifest(const vector<path>& imports) const;
+
+	void readStats(uintmax_t& hits, uintmax_t& misses) const;
+
+	void addStats(bool hit) const;
+
+	void evict() const;
+
+public:
+	CompileCache(const path& dir, uintmax_t maxSize)
+	: dir(dir), maxSize(maxSize) {}
+
+	bool restore(const path& file, const vector<string>& outputFiles, const variables_map& config);
+
+	void store(const set<path>& files);
+
+	void printStats(ostream& out) const;
+};
+
+#endif
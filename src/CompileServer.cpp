@@ -0,0 +1,182 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <boost/filesystem.hpp>
+
+#include "CompileServer.h"
+
+static bool makeAddress(const string& socketPath, sockaddr_un& addr)
+{
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(addr.sun_path)) {
+		cout << "socket path too long: " << socketPath << endl;
+		return false;
+	}
+	strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+	return true;
+}
+
+bool CompileServer::readAll(int fd, void* data, size_t size)
+{
+	auto ptr = static_cast<char*>(data);
+	while (size > 0) {
+		auto len = read(fd, ptr, size);
+		if (len < 0 && errno == EINTR)
+			continue;
+		else if (len <= 0)
+			return false;
+		ptr += len;
+		size -= len;
+	}
+	return true;
+}
+
+bool CompileServer::writeAll(int fd, const void* data, size_t size)
+{
+	auto ptr = static_cast<const char*>(data);
+	while (size > 0) {
+		auto len = write(fd, ptr, size);
+		if (len < 0 && errno == EINTR)
+			continue;
+		else if (len <= 0)
+			return false;
+		ptr += len;
+		size -= len;
+	}
+	return true;
+}
+
+bool CompileServer::readMessage(int fd, string& msg)
+{
+	uint32_t size;
+	if (!readAll(fd, &size, sizeof(size)))
+		return false;
+	msg.resize(size);
+	return readAll(fd, &msg[0], size);
+}
+
+bool CompileServer::writeMessage(int fd, const string& msg)
+{
+	uint32_t size = msg.size();
+	return writeAll(fd, &size, sizeof(size)) && writeAll(fd, msg.data(), size);
+}
+
+void CompileServer::handle(int client, const Handler& handler)
+{
+	string request;
+	if (!readMessage(client, request))
+		return;
+
+	// request format: cwd \0 arg \0 arg ...
+	vector<string> args;
+	istringstream in(request);
+	for (string arg; getline(in, arg, '\0');)
+		args.push_back(arg);
+	if (args.empty())
+		return;
+	auto cwd = args.front();
+	args.erase(args.begin());
+
+	ostringstream output;
+	boost::system::error_code err;
+	auto serverDir = boost::filesystem::current_path();
+	auto coutBuf = cout.rdbuf(output.rdbuf());
+
+	int32_t ret;
+	try {
+		boost::filesystem::current_path(cwd);
+		ret = handler(args);
+	} catch (exception& e) {
+		output << e.what() << endl;
+		ret = 1;
+	}
+	cout.rdbuf(coutBuf);
+	boost::filesystem::current_path(serverDir, err);
+
+	if (writeAll(client, &ret, sizeof(ret)))
+		writeMessage(client, output.str());
+}
+
+int CompileServer::run(const Handler& handler)
+{
+	sockaddr_un addr;
+	if (!makeAddress(socketPath, addr))
+		return 1;
+
+	auto sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socketPath.c_str());
+	if (sock < 0 || bind(sock, (sockaddr*) &addr, sizeof(addr)) || listen(sock, SOMAXCONN)) {
+		cout << "unable to start server on " << socketPath << ": " << strerror(errno) << endl;
+		return 1;
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	while (true) {
+		auto client = accept(sock, nullptr, nullptr);
+		if (client < 0) {
+			if (errno == EINTR)
+				continue;
+			cout << "server error: " << strerror(errno) << endl;
+			break;
+		}
+		handle(client, handler);
+		close(client);
+	}
+	close(sock);
+	unlink(socketPath.c_str());
+	return 1;
+}
+
+int CompileServer::forward(const string& socketPath, const vector<string>& args)
+{
+	sockaddr_un addr;
+	if (!makeAddress(socketPath, addr))
+		return 1;
+
+	auto sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0 || connect(sock, (sockaddr*) &addr, sizeof(addr))) {
+		cout << "unable to connect to server on " << socketPath << ": " << strerror(errno) << endl;
+		return 1;
+	}
+
+	auto request = boost::filesystem::current_path().string();
+	for (auto& arg : args) {
+		request += '\0';
+		request += arg;
+	}
+
+	int32_t ret;
+	string output;
+	if (!writeMessage(sock, request) || !readAll(sock, &ret, sizeof(ret)) || !readMessage(sock, output)) {
+		cout << "lost connection to server on " << socketPath << endl;
+		close(sock);
+		return 1;
+	}
+	close(sock);
+
+	cout << output;
+	return ret;
+}
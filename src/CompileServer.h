@@ -0,0 +1,57 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __COMPILE_SERVER_H__
+#define __COMPILE_SERVER_H__
+
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Accepts compile requests over a unix socket so state that is expensive
+ * to create (initialized targets, parsed imports) outlives a single
+ * compile. A request holds the client's working directory and command
+ * line, the reply holds the exit code and everything written to cout.
+ */
+class CompileServer
+{
+	typedef function<int(const vector<string>&)> Handler;
+
+	string socketPath;
+
+	static bool readAll(int fd, void* data, size_t size);
+
+	static bool writeAll(int fd, const void* data, size_t size);
+
+	static bool readMessage(int fd, string& msg);
+
+	static bool writeMessage(int fd, const string& msg);
+
+	static void handle(int client, const Handler& handler);
+
+public:
+	explicit CompileServer(string socketPath)
+	: socketPath(std::move(socketPath)) {}
+
+	int run(const Handler& handler);
+
+	static int forward(const string& socketPath, const vector<string>& args);
+};
+
+#endif
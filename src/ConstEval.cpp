@@ -0,0 +1,532 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Instructions.h>
+#include "ConstEval.h"
+
+static uint64_t numElements(Type* type)
+{
+	if (type->isStructTy())
+		return type->getStructNumElements();
+	else if (type->isArrayTy())
+		return type->getArrayNumElements();
+	else if (type->isVectorTy())
+		return type->getVectorNumElements();
+	return 0;
+}
+
+static Type* elementType(Type* type, uint64_t index)
+{
+	if (index >= numElements(type))
+		return nullptr;
+	else if (type->isStructTy())
+		return type->getStructElementType(index);
+	else if (type->isArrayTy())
+		return type->getArrayElementType();
+	return type->getVectorElementType();
+}
+
+ConstEval::Cell::Cell(Constant* value)
+: type(value->getType()), value(value)
+{
+}
+
+bool ConstEval::error(const string& msg)
+{
+	context.addError(msg + " in constant evaluation", token);
+	return false;
+}
+
+bool ConstEval::get(Frame& frame, Value* value, EvalValue& out)
+{
+	auto it = frame.find(value);
+	if (it != frame.end()) {
+		out = it->second;
+		return true;
+	} else if (isa<GlobalVariable>(value)) {
+		return error("can't access global variable " + value->getName().str());
+	} else if (isa<ConstantExpr>(value) || !isa<Constant>(value)) {
+		return error("unsupported value");
+	}
+	out = EvalValue();
+	out.value = cast<Constant>(value);
+	return true;
+}
+
+Constant* ConstEval::getConst(Frame& frame, Value* value)
+{
+	EvalValue val;
+	if (!get(frame, value, val)) {
+		return nullptr;
+	} else if (!val.value) {
+		error("pointer to a local variable used as a value");
+		return nullptr;
+	}
+	return val.value;
+}
+
+bool ConstEval::getIndex(Frame& frame, Value* value, int64_t& index)
+{
+	auto val = getConst(frame, value);
+	if (!val)
+		return false;
+	else if (!isa<ConstantInt>(val))
+		return error("undefined index");
+	index = cast<ConstantInt>(val)->getSExtValue();
+	return true;
+}
+
+bool ConstEval::element(Constant* agg, uint64_t index, Constant*& out)
+{
+	if (index >= numElements(agg->getType()))
+		return error("index " + to_string(index) + " out of bounds");
+	out = agg->getAggregateElement(index);
+	return true;
+}
+
+Constant* ConstEval::read(Cell* cell)
+{
+	if (cell->value)
+		return cell->value;
+
+	vector<Constant*> items;
+	for (auto& item : cell->items)
+		items.push_back(read(&item));
+	if (cell->type->isStructTy())
+		return ConstantStruct::get(cast<StructType>(cell->type), items);
+	else if (cell->type->isArrayTy())
+		return ConstantArray::get(cast<ArrayType>(cell->type), items);
+	return ConstantVector::get(items);
+}
+
+Type* ConstEval::pointeeType(const EvalValue& ptr)
+{
+	auto type = objects[ptr.object].type;
+	for (auto index : ptr.path) {
+		type = elementType(type, index);
+		if (!type)
+			return nullptr;
+	}
+	return type;
+}
+
+bool ConstEval::load(const EvalValue& ptr, Type* type, Constant*& out)
+{
+	if (ptr.object < 0)
+		return error("dereference of a non-local pointer");
+
+	// split cells hold the newest values, whole ones a single constant
+	auto cell = &objects[ptr.object];
+	size_t pos = 0;
+	for (; pos < ptr.path.size() && !cell->value; pos++) {
+		if (ptr.path[pos] >= cell->items.size())
+			return error("index " + to_string(ptr.path[pos]) + " out of bounds");
+		cell = &cell->items[ptr.path[pos]];
+	}
+	out = read(cell);
+	for (; pos < ptr.path.size(); pos++) {
+		if (!element(out, ptr.path[pos], out))
+			return false;
+	}
+	if (out->getType() != type)
+		return error("type punned memory access");
+	return true;
+}
+
+bool ConstEval::store(const EvalValue& ptr, Constant* value)
+{
+	if (ptr.object < 0)
+		return error("dereference of a non-local pointer");
+
+	auto cell = &objects[ptr.object];
+	for (auto index : ptr.path) {
+		auto size = numElements(cell->type);
+		if (index >= size)
+			return error("index " + to_string(index) + " out of bounds");
+		if (cell->value) {
+			for (uint64_t i = 0; i < size; i++)
+				cell->items.push_back(Cell(cell->value->getAggregateElement(i)));
+			cell->value = nullptr;
+		}
+		cell = &cell->items[index];
+	}
+	if (cell->type != value->getType())
+		return error("type punned memory access");
+	cell->value = value;
+	cell->items.clear();
+	return true;
+}
+
+bool ConstEval::gep(Frame& frame, GetElementPtrInst* inst, EvalValue& out)
+{
+	if (!get(frame, inst->getPointerOperand(), out))
+		return false;
+	else if (out.object < 0)
+		return error("pointer arithmetic on a non-local pointer");
+
+	for (unsigned i = 1; i < inst->getNumOperands(); i++) {
+		int64_t index;
+		if (!getIndex(frame, inst->getOperand(i), index))
+			return false;
+		if (i > 1)
+			out.path.push_back(index);
+		else if (!out.path.empty())
+			out.path.back() += index;
+		else if (index)
+			return error("pointer arithmetic outside of a variable");
+	}
+	return true;
+}
+
+bool ConstEval::castOp(Frame& frame, Instruction* inst, EvalValue& out)
+{
+	auto destType = inst->getType();
+	switch (inst->getOpcode()) {
+	case Instruction::PtrToInt:
+	case Instruction::IntToPtr:
+		return error("unsupported pointer cast");
+	case Instruction::BitCast:
+		if (!destType->isPointerTy())
+			break;
+		if (!get(frame, inst->getOperand(0), out))
+			return false;
+		if (out.object < 0) {
+			out.value = ConstantExpr::getBitCast(out.value, destType);
+			return true;
+		}
+		// a pointer to an aggregate becomes a pointer to its first element
+		{
+			auto target = destType->getPointerElementType();
+			auto type = pointeeType(out);
+			auto path = out.path;
+			while (type && type != target && numElements(type)) {
+				path.push_back(0);
+				type = elementType(type, 0);
+			}
+			if (type == target)
+				out.path = path;
+		}
+		return true;
+	default:
+		break;
+	}
+	auto value = getConst(frame, inst->getOperand(0));
+	if (!value)
+		return false;
+	out.value = ConstantExpr::getCast(inst->getOpcode(), value, destType);
+	return true;
+}
+
+bool ConstEval::binaryOp(Instruction* inst, Constant* lhs, Constant* rhs, Constant*& out)
+{
+	switch (inst->getOpcode()) {
+	case Instruction::UDiv:
+	case Instruction::SDiv:
+	case Instruction::URem:
+	case Instruction::SRem:
+		if (rhs->isNullValue())
+			return error("division by zero");
+		break;
+	default:
+		break;
+	}
+	out = ConstantExpr::get(inst->getOpcode(), lhs, rhs);
+	if (isa<UndefValue>(out) && !isa<UndefValue>(lhs) && !isa<UndefValue>(rhs))
+		return error(string("undefined result of ") + inst->getOpcodeName());
+	return true;
+}
+
+bool ConstEval::compare(Frame& frame, CmpInst* inst, Constant*& out)
+{
+	if (!inst->getOperand(0)->getType()->isPointerTy()) {
+		auto lhs = getConst(frame, inst->getOperand(0));
+		auto rhs = lhs? getConst(frame, inst->getOperand(1)) : nullptr;
+		if (!rhs)
+			return false;
+		out = ConstantExpr::getCompare(inst->getPredicate(), lhs, rhs);
+		return true;
+	}
+
+	EvalValue lhs, rhs;
+	if (!get(frame, inst->getOperand(0), lhs) || !get(frame, inst->getOperand(1), rhs))
+		return false;
+	auto equal = lhs.value == rhs.value && lhs.object == rhs.object && lhs.path == rhs.path;
+	switch (inst->getPredicate()) {
+	case CmpInst::ICMP_EQ:
+		out = ConstantInt::getBool(inst->getContext(), equal);
+		return true;
+	case CmpInst::ICMP_NE:
+		out = ConstantInt::getBool(inst->getContext(), !equal);
+		return true;
+	default:
+		return error("ordered pointer comparison");
+	}
+}
+
+bool ConstEval::aggregateOp(Frame& frame, Instruction* inst, Constant*& out)
+{
+	auto agg = getConst(frame, inst->getOperand(0));
+	if (!agg)
+		return false;
+
+	switch (inst->getOpcode()) {
+	case Instruction::ExtractValue:
+		out = agg;
+		for (auto index : cast<ExtractValueInst>(inst)->getIndices()) {
+			if (!element(out, index, out))
+				return false;
+		}
+		return true;
+	case Instruction::ExtractElement: {
+		int64_t index;
+		return getIndex(frame, inst->getOperand(1), index) && element(agg, index, out);
+	}
+	case Instruction::ShuffleVector: {
+		auto other = getConst(frame, inst->getOperand(1));
+		if (!other)
+			return false;
+		out = ConstantExpr::getShuffleVector(agg, other, cast<Constant>(inst->getOperand(2)));
+		return true;
+	}
+	default:
+		break;
+	}
+
+	// insertions are stores into a temporary object
+	auto value = getConst(frame, inst->getOperand(1));
+	if (!value)
+		return false;
+	EvalValue ptr;
+	if (inst->getOpcode() == Instruction::InsertValue) {
+		auto indices = cast<InsertValueInst>(inst)->getIndices();
+		ptr.path.assign(indices.begin(), indices.end());
+	} else {
+		int64_t index;
+		if (!getIndex(frame, inst->getOperand(2), index))
+			return false;
+		ptr.path.push_back(index);
+	}
+	objects.push_back(Cell(agg));
+	ptr.object = objects.size() - 1;
+	auto valid = store(ptr, value);
+	out = read(&objects.back());
+	objects.pop_back();
+	return valid;
+}
+
+bool ConstEval::call(Function* func, const vector<EvalValue>& args, EvalValue& result)
+{
+	auto name = func->getName().str();
+	auto sym = context.loadSymbolGlobal(name);
+	if (!sym.isFunction() || !static_cast<SFunction&>(sym).isConstexpr())
+		return error("call to non-constexpr function " + name);
+	else if (func->empty())
+		return error("call to undefined function " + name);
+	else if (depth >= MaxDepth)
+		return error("more than " + to_string(MaxDepth) + " nested calls");
+
+	Frame frame;
+	auto arg = args.begin();
+	for (auto param = func->arg_begin(); param != func->arg_end(); param++)
+		frame[&*param] = *arg++;
+
+	depth++;
+	auto valid = exec(func, frame, result);
+	depth--;
+	return valid;
+}
+
+bool ConstEval::exec(Function* func, Frame& frame, EvalValue& result)
+{
+	BasicBlock* prev = nullptr;
+	auto block = &func->getEntryBlock();
+	while (true) {
+		BasicBlock* next = nullptr;
+		for (auto& item : *block) {
+			auto inst = &item;
+			if (++steps > MaxSteps)
+				return error("more than " + to_string(MaxSteps) + " steps");
+
+			EvalValue value;
+			switch (inst->getOpcode()) {
+			case Instruction::Alloca: {
+				auto alloc = cast<AllocaInst>(inst);
+				if (alloc->isArrayAllocation())
+					return error("variable sized allocation");
+				objects.push_back(Cell(UndefValue::get(alloc->getAllocatedType())));
+				value.object = objects.size() - 1;
+				break;
+			}
+			case Instruction::Load: {
+				EvalValue ptr;
+				if (!get(frame, inst->getOperand(0), ptr) || !load(ptr, inst->getType(), value.value))
+					return false;
+				break;
+			}
+			case Instruction::Store: {
+				EvalValue ptr, val;
+				if (!get(frame, inst->getOperand(1), ptr) || !get(frame, inst->getOperand(0), val))
+					return false;
+				else if (!val.value)
+					return error("can't store a pointer to a local variable");
+				else if (!store(ptr, val.value))
+					return false;
+				break;
+			}
+			case Instruction::GetElementPtr:
+				if (!gep(frame, cast<GetElementPtrInst>(inst), value))
+					return false;
+				break;
+			case Instruction::ICmp:
+			case Instruction::FCmp:
+				if (!compare(frame, cast<CmpInst>(inst), value.value))
+					return false;
+				break;
+			case Instruction::ExtractValue:
+			case Instruction::InsertValue:
+			case Instruction::ExtractElement:
+			case Instruction::InsertElement:
+			case Instruction::ShuffleVector:
+				if (!aggregateOp(frame, inst, value.value))
+					return false;
+				break;
+			case Instruction::Select: {
+				auto cond = getConst(frame, inst->getOperand(0));
+				if (!cond)
+					return false;
+				else if (!isa<ConstantInt>(cond))
+					return error("select on an undefined value");
+				else if (!get(frame, inst->getOperand(cond->isNullValue()? 2 : 1), value))
+					return false;
+				break;
+			}
+			case Instruction::PHI:
+				if (!get(frame, cast<PHINode>(inst)->getIncomingValueForBlock(prev), value))
+					return false;
+				break;
+			case Instruction::Call: {
+				auto callInst = cast<CallInst>(inst);
+				auto callee = callInst->getCalledFunction();
+				if (!callee)
+					return error("indirect function call");
+
+				vector<EvalValue> args(callInst->getNumArgOperands());
+				for (unsigned i = 0; i < args.size(); i++) {
+					if (!get(frame, callInst->getArgOperand(i), args[i]))
+						return false;
+				}
+				if (!call(callee, args, value))
+					return false;
+				break;
+			}
+			case Instruction::Br: {
+				auto branch = cast<BranchInst>(inst);
+				if (branch->isUnconditional()) {
+					next = branch->getSuccessor(0);
+					break;
+				}
+				auto cond = getConst(frame, branch->getCondition());
+				if (!cond)
+					return false;
+				else if (!isa<ConstantInt>(cond))
+					return error("branch on an undefined value");
+				next = branch->getSuccessor(cond->isNullValue()? 1 : 0);
+				break;
+			}
+			case Instruction::Switch: {
+				auto switchInst = cast<SwitchInst>(inst);
+				auto cond = getConst(frame, switchInst->getCondition());
+				if (!cond)
+					return false;
+				else if (!isa<ConstantInt>(cond))
+					return error("switch on an undefined value");
+#if LLVM_VERSION_MAJOR >= 5
+				next = switchInst->findCaseValue(cast<ConstantInt>(cond))->getCaseSuccessor();
+#else
+				next = switchInst->findCaseValue(cast<ConstantInt>(cond)).getCaseSuccessor();
+#endif
+				break;
+			}
+			case Instruction::Ret:
+				return !inst->getNumOperands() || get(frame, inst->getOperand(0), result);
+			case Instruction::Unreachable:
+				return error("unreachable code reached");
+			default:
+				if (inst->isBinaryOp()) {
+					auto lhs = getConst(frame, inst->getOperand(0));
+					auto rhs = lhs? getConst(frame, inst->getOperand(1)) : nullptr;
+					if (!rhs || !binaryOp(inst, lhs, rhs, value.value))
+						return false;
+				} else if (inst->isCast()) {
+					if (!castOp(frame, inst, value))
+						return false;
+				} else {
+					return error(string("unsupported instruction ") + inst->getOpcodeName());
+				}
+				break;
+			}
+			frame[inst] = value;
+		}
+		if (!next)
+			return error("block without a terminator");
+		prev = block;
+		block = next;
+	}
+}
+
+Constant* ConstEval::run(Function* func)
+{
+	Frame frame;
+	EvalValue result;
+	if (!exec(func, frame, result)) {
+		return nullptr;
+	} else if (!result.value) {
+		error("can't return a pointer to a local variable");
+		return nullptr;
+	}
+	return result.value;
+}
+
+static bool calleesDefined(CodeContext& context, Function* func, set<Function*>& seen)
+{
+	if (!seen.insert(func).second)
+		return true;
+	for (auto& block : *func) {
+		for (auto& inst : block) {
+			auto call = dyn_cast<CallInst>(&inst);
+			auto callee = call? call->getCalledFunction() : nullptr;
+			if (!callee) {
+				continue;
+			} else if (callee->empty()) {
+				// other functions are rejected when the call is evaluated
+				auto sym = context.loadSymbolGlobal(callee->getName().str());
+				if (sym.isFunction() && static_cast<SFunction&>(sym).isConstexpr())
+					return false;
+			} else if (!calleesDefined(context, callee, seen)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool ConstEval::isDefined(CodeContext& context, Function* func)
+{
+	set<Function*> seen;
+	return calleesDefined(context, func, seen);
+}
@@ -0,0 +1,103 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __CONST_EVAL_H__
+#define __CONST_EVAL_H__
+
+#include <map>
+#include <set>
+#include <vector>
+#include "CodeContext.h"
+
+// interprets the generated IR of #[constexpr] functions so their result
+// can be used as a global variable initializer
+class ConstEval
+{
+	// a pointer is a memory object and the element path inside it
+	struct EvalValue
+	{
+		Constant* value = nullptr;
+		int object = -1;
+		vector<uint64_t> path;
+	};
+
+	// memory is split into cells only where it's written to, so a
+	// store doesn't rebuild the whole aggregate constant
+	struct Cell
+	{
+		Type* type;
+		Constant* value;
+		vector<Cell> items;
+
+		explicit Cell(Constant* value);
+	};
+
+	typedef map<const Value*, EvalValue> Frame;
+
+	static const uint64_t MaxSteps = 10000000;
+	static const int MaxDepth = 256;
+
+	CodeContext& context;
+	Token* token;
+	vector<Cell> objects;
+	uint64_t steps = 0;
+	int depth = 0;
+
+	bool error(const string& msg);
+
+	bool get(Frame& frame, Value* value, EvalValue& out);
+
+	Constant* getConst(Frame& frame, Value* value);
+
+	bool getIndex(Frame& frame, Value* value, int64_t& index);
+
+	bool element(Constant* agg, uint64_t index, Constant*& out);
+
+	Constant* read(Cell* cell);
+
+	Type* pointeeType(const EvalValue& ptr);
+
+	bool load(const EvalValue& ptr, Type* type, Constant*& out);
+
+	bool store(const EvalValue& ptr, Constant* value);
+
+	bool gep(Frame& frame, GetElementPtrInst* inst, EvalValue& out);
+
+	bool castOp(Frame& frame, Instruction* inst, EvalValue& out);
+
+	bool binaryOp(Instruction* inst, Constant* lhs, Constant* rhs, Constant*& out);
+
+	bool compare(Frame& frame, CmpInst* inst, Constant*& out);
+
+	bool aggregateOp(Frame& frame, Instruction* inst, Constant*& out);
+
+	bool call(Function* func, const vector<EvalValue>& args, EvalValue& result);
+
+	bool exec(Function* func, Frame& frame, EvalValue& result);
+
+public:
+	ConstEval(CodeContext& context, Token* token)
+	: context(context), token(token) {}
+
+	// returns the result of a function without parameters,
+	// or nullptr after reporting why it can't be evaluated
+	Constant* run(Function* func);
+
+	// false if a #[constexpr] function that func may call has no body yet
+	static bool isDefined(CodeContext& context, Function* func);
+};
+
+#endif
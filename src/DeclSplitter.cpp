@@ -0,0 +1,89 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "parser.h"
+#include "FastLexer.h"
+#include "DeclSplitter.h"
+
+uint64_t DeclSplitter::hash(const char* data, size_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+vector<DeclSpan> DeclSplitter::split(const string& filename, SourceFilePtr source)
+{
+	vector<DeclSpan> spans;
+	FastLexer lexer(filename, source, 1);
+	DeclSpan span;
+	bool inDecl = false, hasInit = false;
+	int depth = 0;
+
+	while (auto id = lexer.lex()) {
+		if (!inDecl) {
+			span.offset = lexer.tokenOffset();
+			span.line = lexer.lineNr();
+			span.col = lexer.colNr() - lexer.tokenLength();
+			inDecl = true;
+			hasInit = false;
+		}
+		span.length = lexer.tokenOffset() + lexer.tokenLength() - span.offset;
+		span.endLine = lexer.lineNr();
+
+		switch (id) {
+		case '{':
+		case '(':
+		case '[':
+		case ParserBase::TT_ATTR_OPEN:
+			depth++;
+			continue;
+		case '}':
+		case ')':
+		case ']':
+			if (depth)
+				depth--;
+			break;
+		case '=':
+			hasInit |= !depth;
+			continue;
+		}
+
+		// a global variable's initializer may hold braces, so only its ';' ends it
+		if (!depth && (id == ';' || (id == '}' && !hasInit))) {
+			span.hash = hash(source->data() + span.offset, span.length);
+			spans.push_back(span);
+			inDecl = false;
+		}
+	}
+	if (inDecl) {
+		span.hash = hash(source->data() + span.offset, span.length);
+		spans.push_back(span);
+	}
+	return spans;
+}
+
+unique_ptr<Parser> DeclSplitter::parser(const string& filename, const SourceFile& source, const DeclSpan& span, vector<Token*>* created)
+{
+	// indent the first line so that columns match the file
+	string text(span.col - 1, ' ');
+	text.append(source.data() + span.offset, span.length);
+	auto buffer = make_shared<const SourceFile>(text.data(), text.size());
+	return unique_ptr<Parser>(new Parser(Lexer::create(filename, buffer, span.line, created)));
+}
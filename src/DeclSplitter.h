@@ -0,0 +1,58 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __DECL_SPLITTER_H__
+#define __DECL_SPLITTER_H__
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "SourceManager.h"
+
+class Parser;
+class Token;
+
+/**
+ * The source range of a top-level declaration, from its first token
+ * through its last one
+ */
+struct DeclSpan
+{
+	size_t offset;
+	size_t length;
+	size_t line;
+	size_t col;
+	size_t endLine;
+	uint64_t hash;
+};
+
+/**
+ * Finds the top-level declarations of a file with the lexer alone, so that
+ * tools can parse just the declarations they need.
+ */
+class DeclSplitter
+{
+public:
+	// 64-bit FNV-1a
+	static uint64_t hash(const char* data, size_t size);
+
+	static vector<DeclSpan> split(const string& filename, SourceFilePtr source);
+
+	// creates a parser over a single span, giving tokens their location in the file
+	static unique_ptr<Parser> parser(const string& filename, const SourceFile& source, const DeclSpan& span, vector<Token*>* created = nullptr);
+};
+
+#endif
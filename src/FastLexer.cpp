@@ -0,0 +1,523 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "FastLexer.h"
+
+/*
+ * Each mask function returns a bit for each of the 16 bytes at ptr
+ * that is in the given character class.
+ */
+#ifdef __SSE2__
+static inline __m128i load(const char* ptr)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+}
+
+static inline __m128i inRange(__m128i chunk, char low, char high)
+{
+	// signed compares, so bytes >= 0x80 are never in range
+	auto above = _mm_cmpgt_epi8(chunk, _mm_set1_epi8(low - 1));
+	auto below = _mm_cmplt_epi8(chunk, _mm_set1_epi8(high + 1));
+	return _mm_and_si128(above, below);
+}
+
+static inline unsigned byteMask(const char* ptr, char c)
+{
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(load(ptr), _mm_set1_epi8(c)));
+}
+
+static inline unsigned byteMask(const char* ptr, char a, char b)
+{
+	auto chunk = load(ptr);
+	auto eq = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(a)), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(b)));
+	return _mm_movemask_epi8(eq);
+}
+
+static inline unsigned spaceMask(const char* ptr)
+{
+	auto chunk = load(ptr);
+	auto sp = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t')));
+	auto nl = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')));
+	return _mm_movemask_epi8(_mm_or_si128(sp, nl));
+}
+
+static inline unsigned wordMask(const char* ptr)
+{
+	auto chunk = load(ptr);
+	auto alpha = inRange(_mm_or_si128(chunk, _mm_set1_epi8(0x20)), 'a', 'z');
+	auto digit = inRange(chunk, '0', '9');
+	auto under = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'));
+	return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+}
+#else
+static inline bool isWord(char c);
+
+template<typename Pred>
+static inline unsigned maskOf(const char* ptr, Pred pred)
+{
+	unsigned mask = 0;
+	for (int i = 0; i < 16; i++)
+		mask |= unsigned(pred(ptr[i])) << i;
+	return mask;
+}
+
+static inline unsigned byteMask(const char* ptr, char c)
+{
+	return maskOf(ptr, [=](char x){ return x == c; });
+}
+
+static inline unsigned byteMask(const char* ptr, char a, char b)
+{
+	return maskOf(ptr, [=](char x){ return x == a || x == b; });
+}
+
+static inline unsigned spaceMask(const char* ptr)
+{
+	return maskOf(ptr, [](char x){ return x == ' ' || x == '\t' || x == '\n' || x == '\r'; });
+}
+
+static inline unsigned wordMask(const char* ptr)
+{
+	return maskOf(ptr, isWord);
+}
+#endif
+
+static inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static inline bool isLetter(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static inline bool isWord(char c)
+{
+	return isLetter(c) || isDigit(c);
+}
+
+// skips [a-zA-Z0-9_]* where digits may be followed by apostrophes
+static const char* skipWord(const char* ptr)
+{
+	for (;;) {
+		unsigned mask;
+		while ((mask = wordMask(ptr)) == 0xffff)
+			ptr += 16;
+		ptr += __builtin_ctz(~mask);
+		if (*ptr != '\'' || !isDigit(ptr[-1]))
+			return ptr;
+		while (*ptr == '\'')
+			ptr++;
+	}
+}
+
+// skips ([0-9]'*)*
+static const char* skipDigits(const char* ptr, bool (*digit)(char) = isDigit)
+{
+	while (digit(*ptr)) {
+		ptr++;
+		while (*ptr == '\'')
+			ptr++;
+	}
+	return ptr;
+}
+
+static const char* skipSuffix(const char* ptr)
+{
+	return *ptr == '_' && isLetter(ptr[1])? skipWord(ptr + 1) : ptr;
+}
+
+struct Keyword
+{
+	const char* name;
+	int id;
+	bool save;
+};
+
+static const Keyword keywords[] = {
+	{"true", ParserBase::TT_TRUE, true}, {"false", ParserBase::TT_FALSE, true},
+	{"null", ParserBase::TT_NULL, true}, {"auto", ParserBase::TT_AUTO, true},
+	{"const", ParserBase::TT_CONST, true}, {"atomic", ParserBase::TT_ATOMIC, true},
+	{"void", ParserBase::TT_VOID, true}, {"bool", ParserBase::TT_BOOL, true},
+	{"int", ParserBase::TT_INT, true}, {"int8", ParserBase::TT_INT8, true},
+	{"int16", ParserBase::TT_INT16, true}, {"int32", ParserBase::TT_INT32, true},
+	{"int64", ParserBase::TT_INT64, true}, {"uint", ParserBase::TT_UINT, true},
+	{"uint8", ParserBase::TT_UINT8, true}, {"uint16", ParserBase::TT_UINT16, true},
+	{"uint32", ParserBase::TT_UINT32, true}, {"uint64", ParserBase::TT_UINT64, true},
+	{"float", ParserBase::TT_FLOAT, true}, {"double", ParserBase::TT_DOUBLE, true},
+	{"alias", ParserBase::TT_ALIAS, false}, {"await", ParserBase::TT_AWAIT, true},
+	{"break", ParserBase::TT_BREAK, true}, {"case", ParserBase::TT_CASE, true},
+	{"class", ParserBase::TT_CLASS, false}, {"continue", ParserBase::TT_CONTINUE, true},
+	{"default", ParserBase::TT_DEFAULT, true}, {"delete", ParserBase::TT_DELETE, true},
+	{"do", ParserBase::TT_DO, false}, {"else", ParserBase::TT_ELSE, false},
+	{"enum", ParserBase::TT_ENUM, false}, {"for", ParserBase::TT_FOR, false},
+	{"goto", ParserBase::TT_GOTO, false}, {"if", ParserBase::TT_IF, false},
+	{"import", ParserBase::TT_IMPORT, false}, {"loop", ParserBase::TT_LOOP, false},
+	{"new", ParserBase::TT_NEW, true}, {"redo", ParserBase::TT_REDO, true},
+	{"return", ParserBase::TT_RETURN, true}, {"struct", ParserBase::TT_STRUCT, false},
+	{"switch", ParserBase::TT_SWITCH, false}, {"this", ParserBase::TT_THIS, true},
+	{"union", ParserBase::TT_UNION, false}, {"until", ParserBase::TT_UNTIL, false},
+	{"vec", ParserBase::TT_VEC, true}, {"while", ParserBase::TT_WHILE, false},
+	{"yield", ParserBase::TT_YIELD, true}
+};
+
+static const size_t MaxKeyword = 8;
+
+// keywords bucketed by length and first letter
+struct KeywordTable
+{
+	vector<const Keyword*> buckets[MaxKeyword + 1][26];
+
+	KeywordTable()
+	{
+		for (auto& word : keywords)
+			buckets[strlen(word.name)][word.name[0] - 'a'].push_back(&word);
+	}
+
+	const Keyword* find(const char* str, size_t len) const
+	{
+		if (len > MaxKeyword || str[0] < 'a' || str[0] > 'z')
+			return nullptr;
+		for (auto word : buckets[len][str[0] - 'a']) {
+			if (!memcmp(word->name, str, len))
+				return word;
+		}
+		return nullptr;
+	}
+};
+
+FastLexer::FastLexer(const string& filename)
+: fname(filename), line(1), tokLen(0), hasText(false), atEnd(false), sval(nullptr), created(nullptr)
+{
+	source = SourceManager::get(filename);
+	pos = lineStart = tokStart = source->data();
+	end = pos + source->size();
+}
+
+FastLexer::FastLexer(const string& filename, SourceFilePtr source, size_t firstLine, vector<Token*>* created)
+: fname(filename), source(source), line(firstLine), tokLen(0), hasText(false), atEnd(false), sval(nullptr), created(created)
+{
+	pos = lineStart = tokStart = source->data();
+	end = pos + source->size();
+}
+
+const char* FastLexer::find(const char* ptr, char c) const
+{
+	while (ptr < end) {
+		auto mask = byteMask(ptr, c);
+		if (mask)
+			return min(ptr + __builtin_ctz(mask), end);
+		ptr += 16;
+	}
+	return end;
+}
+
+void FastLexer::countLines(const char* from, const char* to)
+{
+	for (auto ptr = from; ptr < to; ptr += 16) {
+		auto mask = byteMask(ptr, '\n');
+		if (to - ptr < 16)
+			mask &= (1u << (to - ptr)) - 1;
+		if (mask) {
+			line += __builtin_popcount(mask);
+			lineStart = ptr + (31 - __builtin_clz(mask)) + 1;
+		}
+	}
+}
+
+const char* FastLexer::skipComment(const char* ptr) const
+{
+	// comments nest, so every '/' and '*' is checked for an opening or closing pair
+	size_t depth = 1;
+	while (ptr < end) {
+		auto mask = byteMask(ptr, '*') | byteMask(ptr, '/');
+		if (!mask) {
+			ptr += 16;
+			continue;
+		}
+		ptr += __builtin_ctz(mask);
+		if (ptr >= end) {
+			break;
+		} else if (ptr[0] == '*' && ptr[1] == '/') {
+			ptr += 2;
+			if (!--depth)
+				return ptr;
+		} else if (ptr[0] == '/' && ptr[1] == '*') {
+			ptr += 2;
+			depth++;
+		} else {
+			ptr++;
+		}
+	}
+	return nullptr;
+}
+
+void FastLexer::skipSpace()
+{
+	for (;;) {
+		// indentation and blank lines are skipped a vector at a time
+		for (;;) {
+			auto spaces = spaceMask(pos);
+			auto len = spaces == 0xffff? 16 : __builtin_ctz(~spaces);
+			auto lines = byteMask(pos, '\n') & ((1u << len) - 1);
+			if (lines) {
+				line += __builtin_popcount(lines);
+				lineStart = pos + (31 - __builtin_clz(lines)) + 1;
+			}
+			pos += len;
+			if (len < 16)
+				break;
+		}
+
+		if (pos[0] != '/') {
+			return;
+		} else if (pos[1] == '/') {
+			pos = find(pos + 2, '\n');
+		} else if (pos[1] == '*') {
+			auto close = skipComment(pos + 2);
+			if (!close)
+				// left for lex() to return as an unterminated comment
+				return;
+			countLines(pos + 2, close);
+			pos = close;
+		} else {
+			return;
+		}
+	}
+}
+
+int FastLexer::token(size_t len, int id, bool save)
+{
+	tokStart = pos;
+	tokLen = len;
+	hasText = false;
+	pos += len;
+	if (save && sval) {
+		sval->t_tok = new Token(string(tokStart, len), fname, line, tokStart - lineStart + 1);
+		if (created)
+			created->push_back(sval->t_tok);
+	}
+	return id;
+}
+
+int FastLexer::lex()
+{
+	skipSpace();
+	if (pos >= end) {
+		tokStart = pos;
+		tokLen = 0;
+		hasText = false;
+		atEnd = true;
+		return 0;
+	} else if (pos[0] == '/' && pos[1] == '*') {
+		// an unterminated comment runs to the end of the file
+		auto id = token(2, '/');
+		countLines(pos, end);
+		pos = end;
+		return id;
+	}
+
+	auto c = *pos;
+	if (isLetter(c))
+		return lexWord();
+	else if (isDigit(c))
+		return lexNumber();
+	else if (c == '"' || c == '`')
+		return lexQuoted();
+	else if (c == '\'')
+		return lexChar();
+	return lexOperator();
+}
+
+const string& FastLexer::matched()
+{
+	if (!hasText) {
+		text.assign(tokStart, tokLen);
+		hasText = true;
+	}
+	return text;
+}
+
+int FastLexer::lexWord()
+{
+	static const KeywordTable table;
+
+	size_t len = skipWord(pos + 1) - pos;
+	auto word = table.find(pos, len);
+	if (word)
+		return token(len, word->id, word->save);
+	return token(len, ParserBase::TT_IDENTIFIER);
+}
+
+int FastLexer::lexNumber()
+{
+	static const struct { char prefix; bool (*digit)(char); int id; } bases[] = {
+		{'b', [](char c){ return c == '0' || c == '1'; }, ParserBase::TT_INT_BIN},
+		{'o', [](char c){ return c >= '0' && c <= '7'; }, ParserBase::TT_INT_OCT},
+		{'x', [](char c){ return isDigit(c) || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f'); }, ParserBase::TT_INT_HEX}
+	};
+
+	if (pos[0] == '0') {
+		for (auto& base : bases) {
+			if (pos[1] == base.prefix && base.digit(pos[2]))
+				return token(skipSuffix(skipDigits(pos + 2, base.digit)) - pos, base.id);
+		}
+	}
+
+	auto ptr = skipDigits(pos);
+	auto id = ParserBase::TT_INTEGER;
+	if (ptr[0] == '.' && isDigit(ptr[1])) {
+		ptr = skipDigits(ptr + 1);
+		id = ParserBase::TT_FLOATING;
+		if ((ptr[0] | 0x20) == 'e') {
+			auto exp = ptr + 1;
+			if (*exp == '+' || *exp == '-')
+				exp++;
+			if (isDigit(*exp))
+				ptr = skipDigits(exp);
+		}
+	}
+	return token(skipSuffix(ptr) - pos, id);
+}
+
+int FastLexer::lexQuoted()
+{
+	auto quote = *pos;
+	auto ptr = pos + 1;
+	for (;;) {
+		while (ptr < end) {
+			auto mask = byteMask(ptr, quote, '\\');
+			if (mask) {
+				ptr += __builtin_ctz(mask);
+				break;
+			}
+			ptr += 16;
+		}
+		if (ptr >= end)
+			// unterminated, only the quote is a token
+			return token(1, quote);
+		else if (*ptr == quote)
+			break;
+		// an escape can't be followed by a newline
+		ptr += ptr[1] != '\n' && ptr + 1 < end? 2 : 1;
+	}
+
+	auto start = pos;
+	auto id = token(ptr + 1 - pos, ParserBase::TT_STR_LIT);
+	countLines(start, pos);
+	return id;
+}
+
+int FastLexer::lexChar()
+{
+	size_t len = 1;
+	if (pos[1] == '\\' && pos[2] != '\n' && pos[3] == '\'')
+		len = 4;
+	else if (pos[1] != '\'' && pos[2] == '\'')
+		len = 3;
+	if (pos + len > end)
+		len = 1;
+	if (len == 1)
+		return token(1, '\'');
+
+	auto start = pos;
+	auto id = token(len, ParserBase::TT_CHAR_LIT);
+	countLines(start, pos);
+	return id;
+}
+
+int FastLexer::lexOperator()
+{
+	auto next = pos[1];
+	switch (pos[0]) {
+	case '<':
+		if (next == '<')
+			return pos[2] == '='? token(3, ParserBase::TT_ASG_LSH) : token(2, ParserBase::TT_LSHIFT);
+		else if (next == '=')
+			return token(2, ParserBase::TT_LEQ);
+		break;
+	case '>':
+		if (next == '>')
+			return pos[2] == '='? token(3, ParserBase::TT_ASG_RSH) : token(2, ParserBase::TT_RSHIFT);
+		else if (next == '=')
+			return token(2, ParserBase::TT_GEQ);
+		break;
+	case '?':
+		if (next == '?')
+			return pos[2] == '='? token(3, ParserBase::TT_ASG_DQ) : token(2, ParserBase::TT_DQ_MARK);
+		break;
+	case '!':
+		if (next == '=')
+			return token(2, ParserBase::TT_NEQ);
+		break;
+	case '=':
+		if (next == '=')
+			return token(2, ParserBase::TT_EQ);
+		break;
+	case '&':
+		if (next == '&')
+			return token(2, ParserBase::TT_LOG_AND);
+		else if (next == '=')
+			return token(2, ParserBase::TT_ASG_AND);
+		break;
+	case '|':
+		if (next == '|')
+			return token(2, ParserBase::TT_LOG_OR);
+		else if (next == '=')
+			return token(2, ParserBase::TT_ASG_XOR);
+		break;
+	case '^':
+		if (next == '=')
+			return token(2, ParserBase::TT_ASG_OR);
+		break;
+	case '*':
+		if (next == '=')
+			return token(2, ParserBase::TT_ASG_MUL);
+		break;
+	case '/':
+		if (next == '=')
+			return token(2, ParserBase::TT_ASG_DIV);
+		break;
+	case '%':
+		if (next == '=')
+			return token(2, ParserBase::TT_ASG_MOD);
+		break;
+	case '+':
+		if (next == '+')
+			return token(2, ParserBase::TT_INC);
+		else if (next == '=')
+			return token(2, ParserBase::TT_ASG_ADD);
+		break;
+	case '-':
+		if (next == '-')
+			return token(2, ParserBase::TT_DEC);
+		else if (next == '=')
+			return token(2, ParserBase::TT_ASG_SUB);
+		else if (next == '>')
+			return token(2, ParserBase::TT_ARROW, false);
+		break;
+	case '#':
+		if (next == '[')
+			return token(2, ParserBase::TT_ATTR_OPEN, false);
+		break;
+	}
+	return token(1, pos[0]);
+}
@@ -0,0 +1,114 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __FAST_LEXER_H__
+#define __FAST_LEXER_H__
+
+#include "Lexer.h"
+#include "SourceManager.h"
+
+/**
+ * A hand-written replacement for the flexc++ Scanner. The file is
+ * memory-mapped through the SourceManager and whitespace, comments, words and string
+ * literals are scanned 16 bytes at a time using SSE2 when available.
+ * It produces the same tokens as Scanner.l.
+ */
+class FastLexer : public Lexer
+{
+	string fname;
+	SourceFilePtr source;
+	const char* pos;
+	const char* end;
+
+	size_t line;
+	const char* lineStart;
+
+	// the last token
+	const char* tokStart;
+	size_t tokLen;
+	string text;
+	bool hasText;
+	bool atEnd;
+
+	ParserBase::STYPE__* sval;
+
+	// when set, every token handed to the parser is also added here
+	vector<Token*>* created;
+
+	const char* skipComment(const char* ptr) const;
+
+	void skipSpace();
+
+	void countLines(const char* from, const char* to);
+
+	const char* find(const char* ptr, char c) const;
+
+	int token(size_t len, int id, bool save = true);
+
+	int lexWord();
+
+	int lexNumber();
+
+	int lexQuoted();
+
+	int lexChar();
+
+	int lexOperator();
+
+public:
+	explicit FastLexer(const string& filename);
+
+	// lexes a buffer holding part of a file, whose first line is firstLine
+	FastLexer(const string& filename, SourceFilePtr source, size_t firstLine, vector<Token*>* created = nullptr);
+
+	// offset of the last token from the start of the buffer
+	size_t tokenOffset() const
+	{
+		return tokStart - source->data();
+	}
+
+	size_t tokenLength() const
+	{
+		return tokLen;
+	}
+
+	int lex();
+
+	const string& matched();
+
+	const string& filename() const
+	{
+		return fname;
+	}
+
+	size_t lineNr() const
+	{
+		return line;
+	}
+
+	size_t colNr()
+	{
+		// the flex scanner counts the end of file as a column
+		return pos - lineStart + (atEnd? 2 : 1);
+	}
+
+	void setSval(ParserBase::STYPE__* dval)
+	{
+		sval = dval;
+	}
+};
+
+#endif
@@ -0,0 +1,54 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "parser.h"
+#include "ImportCache.h"
+
+typedef boost::system::error_code fs_error;
+
+ImportCache::ImportCache() = default;
+
+ImportCache::~ImportCache() = default;
+
+Parser* ImportCache::get(const path& filename)
+{
+	auto it = entries.find(absolute(filename).string());
+	if (it == entries.end())
+		return nullptr;
+
+	fs_error err;
+	auto mtime = last_write_time(filename, err);
+	auto size = err? 0 : file_size(filename, err);
+	if (err || mtime != it->second.mtime || size != it->second.size) {
+		entries.erase(it);
+		return nullptr;
+	}
+	return it->second.parser.get();
+}
+
+void ImportCache::put(const path& filename, unique_ptr<Parser> parser)
+{
+	fs_error err;
+	auto mtime = last_write_time(filename, err);
+	auto size = err? 0 : file_size(filename, err);
+	if (err)
+		return;
+
+	auto& entry = entries[absolute(filename).string()];
+	entry.mtime = mtime;
+	entry.size = size;
+	entry.parser = std::move(parser);
+}
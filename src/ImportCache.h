@@ -0,0 +1,54 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __IMPORT_CACHE_H__
+#define __IMPORT_CACHE_H__
+
+#include <map>
+#include <memory>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+using namespace boost::filesystem;
+
+class Parser;
+
+/**
+ * Keeps parsed import files alive between compiles. An entry is reused
+ * as long as the file's modification time and size are unchanged.
+ */
+class ImportCache
+{
+	struct Entry
+	{
+		time_t mtime;
+		uintmax_t size;
+		unique_ptr<Parser> parser;
+	};
+
+	map<string, Entry> entries;
+
+public:
+	ImportCache();
+
+	~ImportCache();
+
+	Parser* get(const path& filename);
+
+	void put(const path& filename, unique_ptr<Parser> parser);
+};
+
+#endif
@@ -0,0 +1,102 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <unordered_map>
+#include "parser.h"
+#include "IncrementalParser.h"
+
+IncrementalParser::IncrementalParser(const string& filename)
+: filename(filename), root(false), parsedCount(0)
+{
+}
+
+IncrementalParser::~IncrementalParser()
+{
+}
+
+int IncrementalParser::parse()
+{
+	SourceManager::release(filename);
+	auto source = SourceManager::get(filename);
+	auto spans = DeclSplitter::split(filename, source);
+
+	unordered_multimap<uint64_t, shared_ptr<Decl>> previous;
+	for (auto& decl : decls)
+		previous.emplace(decl->span.hash, decl);
+
+	vector<shared_ptr<Decl>> next;
+	next.reserve(spans.size());
+	parsedCount = 0;
+	for (auto& span : spans) {
+		shared_ptr<Decl> decl;
+		auto range = previous.equal_range(span.hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			auto& old = it->second->span;
+			if (old.length == span.length && old.col == span.col) {
+				decl = it->second;
+				previous.erase(it);
+				break;
+			}
+		}
+		if (!decl) {
+			decl = make_shared<Decl>();
+			decl->span = span;
+			decl->parser = DeclSplitter::parser(filename, *source, span, &decl->tokens);
+			if (decl->parser->parse()) {
+				// keep the last good parse
+				error = decl->parser->getError();
+				return 1;
+			}
+			parsedCount++;
+		}
+		next.push_back(decl);
+	}
+
+	for (size_t i = 0; i < next.size(); i++) {
+		auto& decl = *next[i];
+		int shift = spans[i].line - decl.span.line;
+		if (shift) {
+			for (auto token : decl.tokens)
+				token->line += shift;
+		}
+		decl.span = spans[i];
+	}
+	decls.swap(next);
+	buildRoot();
+	return 0;
+}
+
+void IncrementalParser::invalidate(function<bool(NStatement*)> predicate)
+{
+	decls.erase(remove_if(decls.begin(), decls.end(), [&](const shared_ptr<Decl>& decl){
+		for (auto stm : *decl->parser->getRoot()) {
+			if (predicate(stm))
+				return true;
+		}
+		return false;
+	}), decls.end());
+	buildRoot();
+}
+
+void IncrementalParser::buildRoot()
+{
+	root.clear();
+	for (auto& decl : decls) {
+		for (auto stm : *decl->parser->getRoot())
+			root.add(stm);
+	}
+}
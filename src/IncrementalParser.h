@@ -0,0 +1,82 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __INCREMENTAL_PARSER_H__
+#define __INCREMENTAL_PARSER_H__
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include "AST.h"
+#include "DeclSplitter.h"
+
+/**
+ * Parses a file that is edited between parses. Each top-level declaration
+ * is parsed by itself and kept along with the hash of its source, so a new
+ * parse only parses the declarations whose source changed. Unchanged ones
+ * are reused, moving their tokens to their new lines.
+ */
+class IncrementalParser
+{
+	struct Decl
+	{
+		DeclSpan span;
+		unique_ptr<Parser> parser;
+		vector<Token*> tokens;
+	};
+
+	string filename;
+	vector<shared_ptr<Decl>> decls;
+	NStatementList root;
+	Token error;
+	size_t parsedCount;
+
+	void buildRoot();
+
+public:
+	explicit IncrementalParser(const string& filename);
+
+	~IncrementalParser();
+
+	// reads the file again, returning non-zero on a syntax error like Parser::parse
+	int parse();
+
+	// drops the declarations matching the predicate, so the next parse reads them again
+	void invalidate(function<bool(NStatement*)> predicate);
+
+	NStatementList* getRoot()
+	{
+		return &root;
+	}
+
+	Token getError() const
+	{
+		return error;
+	}
+
+	// the number of declarations parsed by the last parse
+	size_t parsed() const
+	{
+		return parsedCount;
+	}
+
+	size_t size() const
+	{
+		return decls.size();
+	}
+};
+
+#endif
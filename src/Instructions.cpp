@@ -19,6 +19,7 @@
 #include "CGNDataType.h"
 #include "CGNVariable.h"
 #include "CGNExpression.h"
+#include "Builder.h"
 
 void Inst::castError(CodeContext& context, const string& msg, SType* from, SType* to, Token* token)
 {
@@ -53,6 +54,12 @@ bool Inst::CastTo(CodeContext& context, Token* token, RValue& value, SType* type
 	if (!value)
 		return true;
 
+	// atomic only qualifies storage; values are always non-atomic
+	type = SType::getNonAtomic(context, type);
+	// bit-fields hold values of their declared type
+	if (type->isBitField())
+		type = type->subType();
+	value = RValue(value.value(), SType::getNonAtomic(context, value.stype()));
 	auto valueType = value.stype();
 
 	if (type == valueType) {
@@ -383,23 +390,387 @@ RValue Inst::Load(CodeContext& context, RValue value)
 		// don't require address-of operator for converting
 		// a function into a function pointer
 		return RValue(value.value(), SType::getPointer(context, value.stype()));
+	else if (value.stype()->isBitField())
+		return LoadBitField(context, value);
 	else if (value.type() == value.stype()->type())
 		return value;
 
-	return RValue(new LoadInst(value, "", context), value.stype());
+	return CreateLoad(context, value, value.stype());
+}
+
+RValue Inst::LoadBitField(CodeContext& context, RValue ptr)
+{
+	auto field = static_cast<SBitFieldType*>(ptr.stype());
+	auto type = field->subType();
+	auto unitBits = field->type()->getIntegerBitWidth();
+	Value* value = new LoadInst(ptr, "", context);
+
+	// move the field to the top bits, then shift it back down to extend the sign
+	auto high = unitBits - field->getOffset() - field->size();
+	if (high)
+		value = BinaryOperator::Create(Instruction::Shl, value, ConstantInt::get(field->type(), high), "", context);
+	auto low = unitBits - field->size();
+	if (low) {
+		auto op = type->isUnsigned()? Instruction::LShr : Instruction::AShr;
+		value = BinaryOperator::Create(op, value, ConstantInt::get(field->type(), low), "", context);
+	}
+	if (unitBits != type->size())
+		value = CastInst::CreateIntegerCast(value, *type, !type->isUnsigned(), "", context);
+	return RValue(value, type);
+}
+
+void Inst::StoreBitField(CodeContext& context, RValue value, RValue ptr)
+{
+	auto field = static_cast<SBitFieldType*>(ptr.stype());
+	auto unitType = field->type();
+	auto unitBits = unitType->getIntegerBitWidth();
+
+	Value* bits = value;
+	if (unitBits != field->subType()->size())
+		bits = CastInst::CreateIntegerCast(bits, unitType, false, "", context);
+	if (field->size() == unitBits) {
+		new StoreInst(bits, ptr, context);
+		return;
+	}
+
+	// clear the field in the storage unit and merge in the new bits
+	auto mask = APInt::getBitsSet(unitBits, field->getOffset(), field->getOffset() + field->size());
+	if (field->getOffset())
+		bits = BinaryOperator::Create(Instruction::Shl, bits, ConstantInt::get(unitType, field->getOffset()), "", context);
+	bits = BinaryOperator::Create(Instruction::And, bits, ConstantInt::get(unitType, mask), "", context);
+	auto old = new LoadInst(ptr, "", context);
+	auto rest = BinaryOperator::Create(Instruction::And, old, ConstantInt::get(unitType, ~mask), "", context);
+	auto merged = BinaryOperator::Create(Instruction::Or, rest, bits, "", context);
+	new StoreInst(merged, ptr, context);
 }
 
 RValue Inst::Deref(CodeContext& context, const RValue& value, bool recursive)
 {
 	auto retVal = RValue(value.value(), value.stype());
 	while (retVal.stype()->isPointer()) {
-		retVal = RValue(new LoadInst(retVal, "", context), retVal.stype()->subType());
+		auto ptrType = CreateLoad(context, retVal, retVal.stype());
+		retVal = RValue(ptrType.value(), ptrType.stype()->subType());
 		if (!recursive)
 			break;
 	}
 	return retVal;
 }
 
+RValue Inst::CreateLoad(CodeContext& context, Value* ptr, SType* type)
+{
+	auto load = new LoadInst(ptr, "", context);
+	if (!type->isAtomic())
+		return RValue(load, type);
+
+	load->setAlignment(SType::allocSize(context, type));
+	load->setAtomic(ATOMIC_ORDER(SequentiallyConsistent));
+	return RValue(load, SType::getNonAtomic(context, type));
+}
+
+void Inst::Store(CodeContext& context, RValue value, RValue ptr)
+{
+	if (ptr.stype()->isBitField()) {
+		StoreBitField(context, value, ptr);
+		return;
+	}
+	auto store = new StoreInst(value, ptr, context);
+	if (!ptr.stype()->isAtomic())
+		return;
+
+	store->setAlignment(SType::allocSize(context, ptr.stype()));
+	store->setAtomic(ATOMIC_ORDER(SequentiallyConsistent));
+}
+
+Value* Inst::AtomicInt(CodeContext& context, Value* value, SType* type, bool storage)
+{
+	if (!type->isPointer())
+		return value;
+
+	// atomicrmw and cmpxchg only operate on integers
+	auto intType = SType::getInt(context, SType::allocSize(context, type) * 8);
+	if (storage)
+		return new BitCastInst(value, *SType::getPointer(context, intType), "", context);
+	return new PtrToIntInst(value, *intType, "", context);
+}
+
+RValue Inst::AtomicRMW(CodeContext& context, AtomicRMWInst::BinOp op, RValue ptr, RValue val, AtomicOrdering order)
+{
+	auto type = SType::getNonAtomic(context, ptr.stype());
+	auto ptrVal = AtomicInt(context, ptr, type, true);
+	auto newVal = AtomicInt(context, val, type, false);
+
+	auto inst = new AtomicRMWInst(op, ptrVal, newVal, order, SYNC_SCOPE, context);
+	if (!type->isPointer())
+		return RValue(inst, type);
+	return RValue(new IntToPtrInst(inst, *type, "", context), type);
+}
+
+bool Inst::getOrdering(CodeContext& context, NExpression* exp, AtomicOrdering& order)
+{
+	if (exp->id() != NodeId::NStringLiteral) {
+		context.addError("memory order must be a string literal", *exp);
+		return true;
+	}
+	auto name = static_cast<NStringLiteral*>(exp)->getStrVal();
+	if (name == "relaxed")
+		order = ATOMIC_ORDER(Monotonic);
+	else if (name == "acquire")
+		order = ATOMIC_ORDER(Acquire);
+	else if (name == "release")
+		order = ATOMIC_ORDER(Release);
+	else if (name == "acq_rel")
+		order = ATOMIC_ORDER(AcquireRelease);
+	else if (name == "seq_cst")
+		order = ATOMIC_ORDER(SequentiallyConsistent);
+	else {
+		context.addError("invalid memory order: " + name, *exp);
+		return true;
+	}
+	return false;
+}
+
+RValue Inst::AtomicOp(CodeContext& context, NArrowOperator* exp)
+{
+	static const map<string, int> opArgs = {
+		{"load", 0}, {"store", 1}, {"exchange", 1}, {"fetchAdd", 1}, {"fetchSub", 1},
+		{"fetchAnd", 1}, {"fetchOr", 1}, {"fetchXor", 1}, {"cas", 2}};
+
+	auto name = exp->getName()->str;
+	auto item = opArgs.find(name);
+	if (item == opArgs.end()) {
+		context.addError("invalid atomic operation: " + name, *exp);
+		return RValue();
+	} else if (exp->getArgs()) {
+		context.addError("atomic operations take no type arguments", *exp);
+		return RValue();
+	}
+
+	auto args = exp->getExpArgs();
+	auto valCount = item->second;
+	auto maxArgs = valCount + (name == "cas"? 2 : 1);
+	if (args->size() < valCount || args->size() > maxArgs) {
+		context.addError(name + " requires " + to_string(valCount) + " value argument(s) and optional memory order", *exp);
+		return RValue();
+	}
+
+	auto varPtr = dynamic_cast<NVariable*>(exp->getExp());
+	if (!varPtr) {
+		context.addError(name + " operator only operates on variable expression", *exp);
+		return RValue();
+	}
+	auto var = CGNVariable::run(context, varPtr);
+	if (!var)
+		return RValue();
+
+	auto varType = var.stype();
+	if (!varType->isAtomic()) {
+		context.addError(name + " requires an atomic variable", *exp);
+		return RValue();
+	} else if (varType->isConst() && name != "load") {
+		context.addError(name + " on a constant variable", *exp);
+		return RValue();
+	}
+	auto type = SType::getNonAtomic(context, SType::getMutable(context, varType));
+	if (type->isPointer() && name.compare(0, 5, "fetch") == 0) {
+		context.addError(name + " requires an atomic integer type", *exp);
+		return RValue();
+	}
+
+	vector<RValue> vals;
+	for (int i = 0; i < valCount; i++) {
+		auto val = CGNExpression::run(context, args->at(i));
+		if (CastTo(context, *args->at(i), val, type))
+			return RValue();
+		vals.push_back(val);
+	}
+
+	auto order = ATOMIC_ORDER(SequentiallyConsistent);
+	if (args->size() > valCount && getOrdering(context, args->at(valCount), order))
+		return RValue();
+
+	if (name == "load") {
+		if (order == ATOMIC_ORDER(Release) || order == ATOMIC_ORDER(AcquireRelease)) {
+			context.addError("invalid memory order for atomic load", *args->at(0));
+			return RValue();
+		}
+		auto load = new LoadInst(var, "", context);
+		load->setAlignment(SType::allocSize(context, type));
+		load->setAtomic(order);
+		return StoreTemporary(context, RValue(load, type));
+	} else if (name == "store") {
+		if (order == ATOMIC_ORDER(Acquire) || order == ATOMIC_ORDER(AcquireRelease)) {
+			context.addError("invalid memory order for atomic store", *args->at(1));
+			return RValue();
+		}
+		auto store = new StoreInst(vals[0], var, context);
+		store->setAlignment(SType::allocSize(context, type));
+		store->setAtomic(order);
+		return RValue(store, SType::getVoid(context));
+	} else if (name == "cas") {
+		auto strongest = AtomicCmpXchgInst::getStrongestFailureOrdering(order);
+		auto failOrder = strongest;
+		if (args->size() > 3) {
+			if (getOrdering(context, args->at(3), failOrder)) {
+				return RValue();
+			} else if (failOrder == ATOMIC_ORDER(Release) || failOrder == ATOMIC_ORDER(AcquireRelease)) {
+				context.addError("invalid failure memory order for cas", *args->at(3));
+				return RValue();
+			} else if ((failOrder == ATOMIC_ORDER(SequentiallyConsistent) && strongest != failOrder)
+				|| (failOrder == ATOMIC_ORDER(Acquire) && strongest == ATOMIC_ORDER(Monotonic))) {
+				context.addError("cas failure memory order is stronger than the success order", *args->at(3));
+				return RValue();
+			}
+		}
+		auto ptrVal = AtomicInt(context, var, type, true);
+		auto cmpVal = AtomicInt(context, vals[0], type, false);
+		auto newVal = AtomicInt(context, vals[1], type, false);
+		auto cas = new AtomicCmpXchgInst(ptrVal, cmpVal, newVal, order, failOrder, SYNC_SCOPE, context);
+		auto success = ExtractValueInst::Create(cas, 1, "", context);
+		return StoreTemporary(context, RValue(success, SType::getBool(context)));
+	}
+
+	static const map<string, AtomicRMWInst::BinOp> rmwOps = {
+		{"exchange", AtomicRMWInst::Xchg}, {"fetchAdd", AtomicRMWInst::Add}, {"fetchSub", AtomicRMWInst::Sub},
+		{"fetchAnd", AtomicRMWInst::And}, {"fetchOr", AtomicRMWInst::Or}, {"fetchXor", AtomicRMWInst::Xor}};
+
+	return StoreTemporary(context, AtomicRMW(context, rmwOps.at(name), var, vals[0], order));
+}
+
+RValue Inst::AtomicFence(CodeContext& context, NArrowOperator* exp)
+{
+	auto name = exp->getName()->str;
+	if (name != "fence") {
+		context.addError("invalid atomic operation: " + name, *exp);
+		return RValue();
+	}
+	auto args = exp->getExpArgs();
+	if (args->size() > 1) {
+		context.addError("fence takes only a memory order argument", *exp);
+		return RValue();
+	}
+	auto order = ATOMIC_ORDER(SequentiallyConsistent);
+	if (args->size() == 1) {
+		if (getOrdering(context, args->at(0), order)) {
+			return RValue();
+		} else if (order == ATOMIC_ORDER(Monotonic)) {
+			context.addError("invalid memory order for fence", *args->at(0));
+			return RValue();
+		}
+	}
+	auto fence = new FenceInst(context, order, SYNC_SCOPE, context);
+	return RValue(fence, SType::getVoid(context));
+}
+
+Value* Inst::CallIntrinsic(CodeContext& context, Intrinsic::ID id, ArrayRef<Value*> args, ArrayRef<Type*> types)
+{
+	auto func = Intrinsic::getDeclaration(context.getModule(), id, types);
+	return CallInst::Create(func, args, "", context);
+}
+
+bool Inst::CoroutineBegin(CodeContext& context, Token* token)
+{
+#if LLVM_VERSION_MAJOR >= 4
+	auto& coro = context.getCoroutine();
+	auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
+	auto nullPtr = RValue::getNullPtr(context, bytePtr);
+	auto malloc = LoadFunction(context, "malloc", bytePtr, {SType::getInt(context, 64)}, token);
+	if (!malloc)
+		return false;
+
+	coro.id = CallIntrinsic(context, Intrinsic::coro_id, {ConstantInt::get(Type::getInt32Ty(context), 0), nullPtr, nullPtr, nullPtr});
+	auto needAlloc = CallIntrinsic(context, Intrinsic::coro_alloc, {coro.id});
+
+	// the frame is only heap allocated when it can outlive the caller
+	auto entryBlock = context.currBlock();
+	auto allocBlock = context.createBlock();
+	auto beginBlock = context.createBlock();
+	BranchInst::Create(allocBlock, beginBlock, needAlloc, context);
+
+	context.pushBlock(allocBlock);
+	auto size = CallIntrinsic(context, Intrinsic::coro_size, {}, {Type::getInt64Ty(context)});
+	auto mem = CallInst::Create(malloc, size, "", context);
+	BranchInst::Create(beginBlock, context);
+
+	context.pushBlock(beginBlock);
+	auto frame = PHINode::Create(*bytePtr, 2, "", context);
+	frame->addIncoming(nullPtr, entryBlock);
+	frame->addIncoming(mem, allocBlock);
+	coro.handle = CallIntrinsic(context, Intrinsic::coro_begin, {coro.id, frame});
+
+	coro.finalBlock = context.createBlock();
+	coro.cleanupBlock = context.createBlock();
+	coro.suspendBlock = context.createBlock();
+	return true;
+#else
+	context.addError("async functions require LLVM 4 or newer", token);
+	return false;
+#endif
+}
+
+void Inst::CoroutineEnd(CodeContext& context, Token* token)
+{
+#if LLVM_VERSION_MAJOR >= 4
+	auto& coro = context.getCoroutine();
+	auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
+
+	// resuming from the final suspend point is undefined, only destroy is valid
+	context.pushBlock(coro.finalBlock);
+	CoroutineSuspend(context, coro.cleanupBlock, true);
+
+	context.pushBlock(coro.cleanupBlock);
+	auto mem = CallIntrinsic(context, Intrinsic::coro_free, {coro.id, coro.handle});
+	auto free = LoadFunction(context, "free", SType::getVoid(context), {bytePtr}, token);
+	if (free)
+		CallInst::Create(free, mem, "", context);
+	BranchInst::Create(coro.suspendBlock, context);
+
+	context.pushBlock(coro.suspendBlock);
+	CallIntrinsic(context, Intrinsic::coro_end, {coro.handle, ConstantInt::getFalse(context)});
+	ReturnInst::Create(context, coro.handle, context);
+#endif
+}
+
+void Inst::CoroutineSuspend(CodeContext& context, BasicBlock* resumeBlock, bool final)
+{
+#if LLVM_VERSION_MAJOR >= 4
+	auto& coro = context.getCoroutine();
+	auto int8 = Type::getInt8Ty(context);
+	auto isFinal = final? ConstantInt::getTrue(context) : ConstantInt::getFalse(context);
+
+	auto state = CallIntrinsic(context, Intrinsic::coro_suspend, {ConstantTokenNone::get(context), isFinal});
+	auto sw = SwitchInst::Create(state, coro.suspendBlock, 2, context);
+	sw->addCase(ConstantInt::get(int8, 0), resumeBlock);
+	sw->addCase(ConstantInt::get(int8, 1), coro.cleanupBlock);
+#endif
+}
+
+void Inst::CoroutineAwait(CodeContext& context, RValue handle)
+{
+#if LLVM_VERSION_MAJOR >= 4
+	// resume the awaited coroutine until it's done, suspending between each step
+	auto checkBlock = context.createBlock();
+	auto resumeBlock = context.createBlock();
+	auto suspendBlock = context.createBlock();
+	auto endBlock = context.createBlock();
+	BranchInst::Create(checkBlock, context);
+
+	context.pushBlock(checkBlock);
+	auto done = CallIntrinsic(context, Intrinsic::coro_done, {handle});
+	BranchInst::Create(endBlock, resumeBlock, done, context);
+
+	context.pushBlock(resumeBlock);
+	CallIntrinsic(context, Intrinsic::coro_resume, {handle});
+	done = CallIntrinsic(context, Intrinsic::coro_done, {handle});
+	BranchInst::Create(endBlock, suspendBlock, done, context);
+
+	context.pushBlock(suspendBlock);
+	CoroutineSuspend(context, checkBlock);
+
+	context.pushBlock(endBlock);
+	CallIntrinsic(context, Intrinsic::coro_destroy, {handle});
+#endif
+}
+
 RValue Inst::SizeOf(CodeContext& context, SType* type, Token* token)
 {
 	if (!type) {
@@ -458,6 +829,21 @@ RValue Inst::SizeOf(CodeContext& context, NArrowOperator* exp)
 	}
 }
 
+SFunction Inst::LoadFunction(CodeContext& context, const string& name, SType* returnTy, const vector<SType*>& params, Token* token)
+{
+	auto func = context.loadSymbol(name);
+	if (!func) {
+		auto funcType = SType::getFunction(context, returnTy, params);
+		Token funcName(name);
+
+		return Builder::getFuncPrototype(context, &funcName, funcType);
+	} else if (!func.isFunction()) {
+		context.addError("Compiler Error: " + name + " not function", token);
+		return SFunction();
+	}
+	return static_cast<SFunction&>(func);
+}
+
 RValue Inst::CallFunction(CodeContext& context, SFunction& func, Token* name, NExpressionList* args, vector<Value*>& expList)
 {
 	// NOTE args can be null
@@ -574,6 +960,66 @@ void Inst::CallDestructor(CodeContext& context, RValue value, Token* valueToken)
 	CallFunction(context, func, valueToken, &argList, exp_list);
 }
 
+SClassType* Inst::LoadAllocator(CodeContext& context, SType* type, Token* token)
+{
+	if (!type->isClass())
+		return nullptr;
+	auto clType = static_cast<SClassType*>(SType::getMutable(context, type));
+	auto name = clType->getAllocator();
+	if (name.empty())
+		return nullptr;
+
+	auto alloc = SUserType::lookup(context, name);
+	if (!alloc || !alloc->isClass()) {
+		context.addError("allocator " + name + " is not a class", token);
+		return nullptr;
+	}
+	return static_cast<SClassType*>(alloc);
+}
+
+RValue Inst::CallAllocator(CodeContext& context, SClassType* clType, RValue arena, const string& funcName, RValue arg, Token* token)
+{
+	auto className = SUserType::lookup(context, clType);
+	auto sym = clType->getItem(funcName);
+	if (!sym || !sym->second.isFunction()) {
+		context.addError("allocator " + className + " has no function " + funcName, token);
+		return RValue();
+	}
+
+	auto func = static_cast<SFunction&>(sym->second);
+	vector<Value*> exp_list;
+	if (!func.isStatic()) {
+		if (arena.isUndef()) {
+			context.addError("allocator function " + className + "." + funcName + " must be static", token);
+			return RValue();
+		}
+		exp_list.push_back(arena);
+	}
+	if (func.numParams() != exp_list.size() + 1) {
+		context.addError("allocator function " + className + "." + funcName + " requires one parameter", token);
+		return RValue();
+	}
+
+	auto param = func.getParam(exp_list.size());
+	auto retType = func.returnTy();
+	if (funcName == "allocate") {
+		if (!param->isInteger() || param->isBool() || !retType->isPointer()) {
+			context.addError("allocator function " + className + ".allocate must take an integer size and return a pointer", token);
+			return RValue();
+		}
+		CastTo(context, token, arg, param);
+	} else if (!param->isPointer() || !retType->isVoid()) {
+		context.addError("allocator function " + className + "." + funcName + " must take a pointer and return void", token);
+		return RValue();
+	} else {
+		arg = RValue(new BitCastInst(arg, *param, "", context), param);
+	}
+	exp_list.push_back(arg);
+
+	auto call = CallInst::Create(func, exp_list, "", context);
+	return RValue(call, retType);
+}
+
 RValue Inst::LoadMemberVar(CodeContext& context, const string& name)
 {
 	auto baseVar = new NBaseVariable(new Token("this"));
@@ -642,7 +1088,7 @@ void Inst::InitVariable(CodeContext& context, RValue var, Token* token, NExpress
 	if (initList) {
 		if (initList->empty()) {
 			// no constructor and empty initializer; do zero initialization
-			new StoreInst(RValue::getZero(context, varType), var, context);
+			Store(context, RValue::getZero(context, SType::getNonAtomic(context, varType)), var);
 		} else if (initList->size() > 1) {
 			context.addError("invalid variable initializer", token);
 		} else {
@@ -652,7 +1098,7 @@ void Inst::InitVariable(CodeContext& context, RValue var, Token* token, NExpress
 
 	if (initVal) {
 		CastTo(context, token, initVal, varType);
-		new StoreInst(initVal, var, context);
+		Store(context, initVal, var);
 	}
 }
 
@@ -663,6 +1109,8 @@ RValue Inst::StoreTemporary(CodeContext& context, RValue value)
 #else
 	auto stackAlloc = new AllocaInst(value.type(), "", context);
 #endif
+	if (auto align = SType::customAlign(context, value.stype()))
+		stackAlloc->setAlignment(align);
 	new StoreInst(value, stackAlloc, context);
 	return RValue(stackAlloc, value.stype());
 }
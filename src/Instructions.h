@@ -17,6 +17,7 @@
 #ifndef __INSTRUCTIONS_H__
 #define __INSTRUCTIONS_H__
 
+#include <llvm/IR/Intrinsics.h>
 #include "AST.h"
 #include "CodeContext.h"
 
@@ -24,6 +25,18 @@ typedef CmpInst::Predicate Predicate;
 typedef Instruction::BinaryOps BinaryOps;
 typedef Instruction::CastOps CastOps;
 
+#if LLVM_VERSION_MAJOR >= 4 || LLVM_VERSION_MINOR >= 9
+	#define ATOMIC_ORDER(ORDER) AtomicOrdering::ORDER
+#else
+	#define ATOMIC_ORDER(ORDER) ORDER
+#endif
+
+#if LLVM_VERSION_MAJOR >= 5
+	#define SYNC_SCOPE SyncScope::System
+#else
+	#define SYNC_SCOPE CrossThread
+#endif
+
 class Inst
 {
 	static inline void castError(CodeContext& context, const string& msg, SType* from, SType* to, Token* token);
@@ -34,15 +47,23 @@ class Inst
 
 	static void NumericCast(RValue& value, SType* from, SType* to, SType* final, CodeContext& context);
 
-	static bool CastMatch(CodeContext& context, Token* optToken, RValue& lhs, RValue& rhs, bool upcast = false);
-
 	static RValue PointerMath(int type, Token* optToken, RValue ptr, const RValue& val, CodeContext& context);
 
 	static RValue CallMemberFunctionNonClass(CodeContext& context, NVariable* baseVar, RValue& baseVal, Token* funcName, NExpressionList* arguments);
 
+	static RValue CreateLoad(CodeContext& context, Value* ptr, SType* type);
+
+	static Value* AtomicInt(CodeContext& context, Value* value, SType* type, bool storage);
+
+	static bool getOrdering(CodeContext& context, NExpression* exp, AtomicOrdering& order);
+
+	static Value* CallIntrinsic(CodeContext& context, Intrinsic::ID id, ArrayRef<Value*> args, ArrayRef<Type*> types = {});
+
 public:
 	static bool CastTo(CodeContext& context, Token* token, RValue& value, SType* type, bool upcast = false);
 
+	static bool CastMatch(CodeContext& context, Token* optToken, RValue& lhs, RValue& rhs, bool upcast = false);
+
 	static RValue CastAs(CodeContext& context, NArrowOperator* exp);
 
 	static RValue BinaryOp(int type, Token* optToken, RValue lhs, RValue rhs, CodeContext& context);
@@ -55,6 +76,26 @@ public:
 
 	static RValue Deref(CodeContext& context, const RValue& value, bool recursive = false);
 
+	static void Store(CodeContext& context, RValue value, RValue ptr);
+
+	static RValue LoadBitField(CodeContext& context, RValue ptr);
+
+	static void StoreBitField(CodeContext& context, RValue value, RValue ptr);
+
+	static RValue AtomicRMW(CodeContext& context, AtomicRMWInst::BinOp op, RValue ptr, RValue val, AtomicOrdering order = ATOMIC_ORDER(SequentiallyConsistent));
+
+	static RValue AtomicOp(CodeContext& context, NArrowOperator* exp);
+
+	static RValue AtomicFence(CodeContext& context, NArrowOperator* exp);
+
+	static bool CoroutineBegin(CodeContext& context, Token* token);
+
+	static void CoroutineEnd(CodeContext& context, Token* token);
+
+	static void CoroutineSuspend(CodeContext& context, BasicBlock* resumeBlock, bool final = false);
+
+	static void CoroutineAwait(CodeContext& context, RValue handle);
+
 	static RValue SizeOf(CodeContext& context, SType* type, Token* token);
 
 	static RValue SizeOf(CodeContext& context, Token* name);
@@ -67,6 +108,8 @@ public:
 		return RValue(ptrVal, type);
 	}
 
+	static SFunction LoadFunction(CodeContext& context, const string& name, SType* returnTy, const vector<SType*>& params, Token* token);
+
 	static RValue CallFunction(CodeContext& context, SFunction& func, Token* name, NExpressionList* args, vector<Value*>& expList);
 
 	static RValue CallMemberFunction(CodeContext& context, NVariable* baseVar, Token* funcName, NExpressionList* arguments);
@@ -77,6 +120,10 @@ public:
 
 	static void CallDestructor(CodeContext& context, RValue value, Token* valueToken);
 
+	static SClassType* LoadAllocator(CodeContext& context, SType* type, Token* token);
+
+	static RValue CallAllocator(CodeContext& context, SClassType* clType, RValue arena, const string& funcName, RValue arg, Token* token);
+
 	static RValue LoadMemberVar(CodeContext& context, const string& name);
 
 	static RValue LoadMemberVar(CodeContext& context, RValue baseVar, Token* baseToken, Token* memberName);
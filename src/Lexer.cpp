@@ -0,0 +1,113 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <iostream>
+#include "Lexer.h"
+#include "scanner.h"
+#include "FastLexer.h"
+
+/**
+ * Reads a SourceFile in place, without copying the mapping
+ */
+class SourceBuf : public streambuf
+{
+public:
+	explicit SourceBuf(const SourceFile& source)
+	{
+		auto begin = const_cast<char*>(source.data());
+		setg(begin, begin, begin + source.size());
+	}
+};
+
+/**
+ * Adapts the flexc++ generated Scanner to the Lexer interface. The
+ * input comes from the SourceManager, so the Scanner shares the file
+ * mapping with the compile cache and the other lexers.
+ */
+class FlexLexer : public Lexer
+{
+	SourceFilePtr source;
+	SourceBuf buffer;
+	istream input;
+	Scanner scanner;
+
+public:
+	explicit FlexLexer(const string& filename)
+	: source(SourceManager::get(filename)), buffer(*source), input(&buffer), scanner(input, cout)
+	{
+		scanner.fname = filename;
+	}
+
+	int lex()
+	{
+		return scanner.lex();
+	}
+
+	const string& matched()
+	{
+		return scanner.matched();
+	}
+
+	const string& filename() const
+	{
+		return scanner.fname;
+	}
+
+	size_t lineNr() const
+	{
+		return scanner.lineNr();
+	}
+
+	size_t colNr()
+	{
+		return scanner.colNr();
+	}
+
+	void setSval(ParserBase::STYPE__* dval)
+	{
+		scanner.setSval(dval);
+	}
+};
+
+static Lexer::Kind defaultKind = Lexer::FLEX;
+
+unique_ptr<Lexer> Lexer::create(const string& filename)
+{
+	return create(defaultKind, filename);
+}
+
+unique_ptr<Lexer> Lexer::create(Kind kind, const string& filename)
+{
+	if (kind == FAST)
+		return unique_ptr<Lexer>(new FastLexer(filename));
+	return unique_ptr<Lexer>(new FlexLexer(filename));
+}
+
+unique_ptr<Lexer> Lexer::create(const string& filename, SourceFilePtr source, size_t firstLine, vector<Token*>* created)
+{
+	return unique_ptr<Lexer>(new FastLexer(filename, source, firstLine, created));
+}
+
+bool Lexer::setDefault(const string& name)
+{
+	if (name == "flex")
+		defaultKind = FLEX;
+	else if (name == "fast")
+		defaultKind = FAST;
+	else
+		return false;
+	return true;
+}
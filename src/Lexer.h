@@ -0,0 +1,65 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __LEXER_H__
+#define __LEXER_H__
+
+#include <memory>
+#include <vector>
+#include "parserbase.h"
+#include "SourceManager.h"
+
+/**
+ * The token source used by the Parser. Both the flexc++ generated
+ * Scanner and the hand-written FastLexer implement this interface.
+ */
+class Lexer
+{
+public:
+	enum Kind { FLEX, FAST };
+
+	// creates a lexer of the default kind for the file
+	static unique_ptr<Lexer> create(const string& filename);
+
+	static unique_ptr<Lexer> create(Kind kind, const string& filename);
+
+	// creates a fast lexer over part of a file, whose first line is firstLine,
+	// optionally recording the tokens it creates
+	static unique_ptr<Lexer> create(const string& filename, SourceFilePtr source, size_t firstLine, vector<Token*>* created = nullptr);
+
+	// selects the default kind by name: flex or fast
+	static bool setDefault(const string& name);
+
+	// returns the next token id, or 0 at the end of the file
+	virtual int lex() = 0;
+
+	// text of the last token, empty at the end of the file
+	virtual const string& matched() = 0;
+
+	virtual const string& filename() const = 0;
+
+	virtual size_t lineNr() const = 0;
+
+	// column just past the last token
+	virtual size_t colNr() = 0;
+
+	// tokens with a value are saved into dval->t_tok
+	virtual void setSval(ParserBase::STYPE__* dval) = 0;
+
+	virtual ~Lexer() {}
+};
+
+#endif
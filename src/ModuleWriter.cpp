@@ -16,28 +16,48 @@
  */
 
 #include "ModuleWriter.h"
+#include "PhaseTimer.h"
 
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/ADT/Triple.h>
+#if LLVM_VERSION_MAJOR >= 4
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#else
+#include <llvm/Bitcode/ReaderWriter.h>
+#endif
 #include <llvm/IR/IRPrintingPasses.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/FormattedStream.h>
 #include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/raw_os_ostream.h>
 #include <llvm/Target/TargetOptions.h>
+#if LLVM_VERSION_MAJOR >= 4
+#include <llvm/Transforms/Coroutines.h>
+#endif
+#include <llvm/Transforms/IPO.h>
+#include <llvm/Transforms/IPO/PassManagerBuilder.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
 
 #include "Pass.h"
 
 using namespace llvm::legacy;
 
+unique_ptr<TargetMachine> ModuleWriter::nativeMachine;
+
 bool ModuleWriter::validModule()
 {
 	ostringstream buff;
@@ -76,10 +96,13 @@ tool_output_file* ModuleWriter::getOutFile(const string& name)
 
 void ModuleWriter::initTarget()
 {
-	InitializeAllTargets();
-	InitializeAllTargetMCs();
-	InitializeAllAsmPrinters();
-	InitializeAllAsmParsers();
+	static std::once_flag initialized;
+	std::call_once(initialized, [](){
+		InitializeAllTargets();
+		InitializeAllTargetMCs();
+		InitializeAllAsmPrinters();
+		InitializeAllAsmParsers();
+	});
 }
 
 TargetMachine* ModuleWriter::getMachine()
@@ -95,6 +118,7 @@ TargetMachine* ModuleWriter::getMachine()
 
 int ModuleWriter::run()
 {
+	PhaseTimer::Scope phase("verify");
 	llvm::legacy::PassManager clean;
 	clean.add(new SimpleBlockClean());
 	clean.run(module);
@@ -102,13 +126,110 @@ int ModuleWriter::run()
 	if (validModule())
 		return 1;
 
-	if (config.count("llvmir"))
+	if (config.count("whole-program") || config.count("optimize")) {
+		PhaseTimer::Scope phase("optimize");
+		if (config.count("whole-program"))
+			internalize();
+		optimize();
+	}
+
+	PhaseTimer::Scope emit("emit");
+	if (config.count("llvmir")) {
 		outputIR();
-	else
-		outputNative();
+	} else {
+		lowerCoroutines();
+		if (!outputNative())
+			return 1;
+	}
 	return 0;
 }
 
+vector<string> ModuleWriter::outputFiles(const string& filename, const variables_map& config)
+{
+	auto base = filename.substr(0, filename.rfind('.'));
+	if (config.count("llvmir"))
+		return {base + ".ll"};
+
+	auto jobs = config.count("jobs")? config["jobs"].as<int>() : 1;
+	if (jobs <= 1)
+		return {base + ".o"};
+
+	vector<string> files;
+	for (int i = 0; i < jobs; i++)
+		files.push_back(base + "." + to_string(i) + ".o");
+	return files;
+}
+
+void ModuleWriter::internalize()
+{
+	// only main is visible outside of a whole-program module
+	for (auto& func : module) {
+		if (!func.isDeclaration() && func.getName() != "main")
+			func.setLinkage(GlobalValue::InternalLinkage);
+	}
+	for (auto& var : module.globals()) {
+		if (!var.isDeclaration())
+			var.setLinkage(GlobalValue::InternalLinkage);
+	}
+}
+
+void ModuleWriter::optimize()
+{
+	PassManagerBuilder builder;
+	builder.OptLevel = 2;
+	builder.Inliner = createFunctionInliningPass();
+#if LLVM_VERSION_MAJOR >= 4
+	addCoroutinePassesToExtensionPoints(builder);
+#endif
+
+	llvm::legacy::FunctionPassManager fpm(&module);
+	builder.populateFunctionPassManager(fpm);
+	fpm.doInitialization();
+	for (auto& func : module)
+		fpm.run(func);
+	fpm.doFinalization();
+
+	llvm::legacy::PassManager pm;
+	builder.populateModulePassManager(pm);
+	pm.run(module);
+
+	// runs last so inlining and mem2reg expose the uses of each pointer
+	unsigned heapToStack = 0;
+	llvm::legacy::PassManager late;
+	late.add(new HeapToStack(heapToStack));
+	late.add(createSROAPass());
+	late.add(createInstructionCombiningPass());
+	late.run(module);
+
+	if (config.count("stats"))
+		cout << "heap allocations moved to stack: " << heapToStack << endl;
+}
+
+void ModuleWriter::lowerCoroutines()
+{
+#if LLVM_VERSION_MAJOR >= 4
+	// optimize() already split the coroutines; otherwise they're still
+	// intrinsics that the code generator can't handle
+	if (config.count("whole-program") || config.count("optimize") || !module.getFunction("llvm.coro.id"))
+		return;
+
+	PassManagerBuilder builder;
+	builder.OptLevel = 0;
+	addCoroutinePassesToExtensionPoints(builder);
+
+	llvm::legacy::FunctionPassManager fpm(&module);
+	builder.populateFunctionPassManager(fpm);
+	fpm.doInitialization();
+	for (auto& func : module)
+		fpm.run(func);
+	fpm.doFinalization();
+
+	llvm::legacy::PassManager pm;
+	builder.populateModulePassManager(pm);
+	pm.run(module);
+#endif
+}
+
 void ModuleWriter::outputIR()
 {
 	llvm::legacy::PassManager pm;
@@ -121,16 +242,83 @@ void ModuleWriter::outputIR()
 	pm.run(module);
 }
 
-void ModuleWriter::outputNative()
+bool ModuleWriter::emitObject(Module& mod, const string& name, TargetMachine& machine)
 {
 	llvm::legacy::PassManager pm;
 
+#if LLVM_VERSION_MAJOR >= 6
+	unique_ptr<ToolOutputFile> objFile(getOutFile(name));
+#else
+	unique_ptr<tool_output_file> objFile(getOutFile(name));
+#endif
+	if (!objFile)
+		return false;
+
+	{
+		buffer_ostream objStream(objFile->os());
+		machine.addPassesToEmitFile(pm, objStream, TargetMachine::CGFT_ObjectFile);
+
+		pm.run(mod);
+	}
+	objFile->keep();
+	return true;
+}
+
+bool ModuleWriter::outputNative()
+{
 	initTarget();
-	auto objFile = getOutFile(filename.substr(0, filename.rfind('.')) + ".o");
 
-	buffer_ostream objStream(objFile->os());
-	unique_ptr<TargetMachine> machine(getMachine());
-	machine->addPassesToEmitFile(pm, objStream, TargetMachine::CGFT_ObjectFile);
+	auto jobs = config.count("jobs")? config["jobs"].as<int>() : 1;
+	if (jobs > 1)
+		return outputSplit(jobs);
+	if (!nativeMachine)
+		nativeMachine.reset(getMachine());
+	if (!emitObject(module, filename.substr(0, filename.rfind('.')) + ".o", *nativeMachine)) {
+		cout << "compiler error: code generation failed" << endl;
+		return false;
+	}
+	return true;
+}
+
+bool ModuleWriter::outputSplit(int jobs)
+{
+	// the parts share the module's LLVMContext, which isn't thread safe, so
+	// each part is moved to its own context through a bitcode buffer
+	vector<SmallVector<char, 0>> parts;
+	SplitModule(CloneModule(&module), jobs, [&](unique_ptr<Module> part){
+		parts.emplace_back();
+		raw_svector_ostream out(parts.back());
+		WriteBitcodeToFile(part.get(), out);
+	});
 
-	pm.run(module);
+	auto base = filename.substr(0, filename.rfind('.'));
+	vector<char> failed(parts.size(), false);
+	vector<thread> workers;
+	for (size_t i = 0; i < parts.size(); i++) {
+		workers.emplace_back([&, i](){
+			LLVMContext llvmContext;
+			MemoryBufferRef buffer(StringRef(parts[i].data(), parts[i].size()), base);
+			auto part = parseBitcodeFile(buffer, llvmContext);
+			if (!part) {
+#if LLVM_VERSION_MAJOR >= 4
+				consumeError(part.takeError());
+#endif
+				failed[i] = true;
+				return;
+			}
+			unique_ptr<TargetMachine> machine(getMachine());
+			failed[i] = !emitObject(**part, base + "." + to_string(i) + ".o", *machine);
+		});
+	}
+	for (auto& worker : workers)
+		worker.join();
+
+	bool success = true;
+	for (size_t i = 0; i < failed.size(); i++) {
+		if (failed[i]) {
+			cout << "compiler error: code generation failed for part " << i << endl;
+			success = false;
+		}
+	}
+	return success;
 }
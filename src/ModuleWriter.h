@@ -34,6 +34,9 @@ class ModuleWriter
 	string filename;
 	variables_map config;
 
+	// kept for the lifetime of the process, see --server
+	static unique_ptr<TargetMachine> nativeMachine;
+
 	bool validModule();
 
 #if LLVM_VERSION_MAJOR >= 6
@@ -46,15 +49,28 @@ class ModuleWriter
 
 	TargetMachine* getMachine();
 
+	void internalize();
+
+	void optimize();
+
+	void lowerCoroutines();
+
+	bool emitObject(Module& mod, const string& name, TargetMachine& machine);
+
 	void outputIR();
 
-	void outputNative();
+	// these return false when an object file couldn't be written
+	bool outputNative();
+
+	bool outputSplit(int jobs);
 
 public:
 	ModuleWriter(Module &module, string filename, variables_map& config)
 	: module(module), filename(std::move(filename)), config(config) {}
 
 	int run();
+
+	static vector<string> outputFiles(const string& filename, const variables_map& config);
 };
 
 #endif
@@ -1,5 +1,5 @@
 %baseclass-preinclude AST.h
-%scanner scanner.h
+%scanner Lexer.h
 %filenames parser
 %parsefun-source parser.cpp
 
@@ -39,7 +39,7 @@
 %token <t_tok> TT_FALSE TT_TRUE TT_NULL
 // base types
 %token <t_tok> TT_AUTO TT_VOID TT_BOOL TT_INT TT_INT8 TT_INT16 TT_INT32 TT_INT64 TT_FLOAT TT_DOUBLE
-%token <t_tok> TT_UINT TT_UINT8 TT_UINT16 TT_UINT32 TT_UINT64 TT_CONST
+%token <t_tok> TT_UINT TT_UINT8 TT_UINT16 TT_UINT32 TT_UINT64 TT_CONST TT_ATOMIC
 // operators
 %token <t_tok> TT_LSHIFT TT_RSHIFT TT_LEQ TT_EQ TT_NEQ TT_GEQ TT_LOG_AND TT_LOG_OR
 %token <t_tok> TT_ASG_MUL TT_ASG_DIV TT_ASG_MOD TT_ASG_ADD TT_ASG_SUB TT_ASG_LSH
@@ -50,7 +50,7 @@
 // keywords
 %token TT_RETURN TT_WHILE TT_DO TT_UNTIL TT_CONTINUE TT_REDO TT_BREAK TT_FOR TT_IF
 %token TT_GOTO TT_SWITCH TT_CASE TT_DEFAULT TT_STRUCT TT_UNION TT_ENUM
-%token TT_DELETE TT_NEW TT_LOOP TT_ALIAS TT_VEC TT_CLASS TT_IMPORT
+%token TT_DELETE TT_NEW TT_LOOP TT_ALIAS TT_VEC TT_CLASS TT_IMPORT TT_YIELD TT_AWAIT
 %left TT_ELSE
 // constants and names
 %token <t_tok> TT_INTEGER TT_FLOATING TT_IDENTIFIER TT_INT_BIN TT_INT_OCT TT_INT_HEX TT_CHAR_LIT TT_STR_LIT TT_THIS
@@ -97,7 +97,7 @@
 %type <t_explist> expression_list
 %type <t_parlist> parameter_list
 %type <t_caslist> switch_case_list
-%type <t_typelist> data_type_list arrow_argument
+%type <t_typelist> data_type_list arrow_argument generic_param_list
 %type <t_var_dec_list> variable_declarations_list variable_declarations_list_or_empty struct_body
 %type <t_initlist> class_initializer_list
 %type <t_attrlist> attribute_list attribute_declaration optional_attribute_declaration
@@ -114,11 +114,17 @@ declaration_list
 	: declaration
 	{
 		$$ = new NStatementList;
-		$$->add($1);
+		if (declHandler)
+			declHandler($1);
+		else
+			$$->add($1);
 	}
 	| declaration_list declaration
 	{
-		$1->add($2);
+		if (declHandler)
+			declHandler($2);
+		else
+			$1->add($2);
 		$$ = $1;
 	}
 	;
@@ -142,6 +148,10 @@ global_variable_declaration
 	{
 		$$ = new NVariableDeclGroup($1, $2);
 	}
+	| attribute_declaration data_type global_variable_list ';'
+	{
+		$$ = new NVariableDeclGroup($2, $3, $1);
+	}
 	;
 alias_declaration
 	: TT_ALIAS TT_IDENTIFIER '=' data_type ';'
@@ -154,6 +164,10 @@ class_declaration
 	{
 		$$ = new NClassDeclaration($3, $4, $1);
 	}
+	| optional_attribute_declaration TT_CLASS TT_IDENTIFIER '<' generic_param_list '>' class_body
+	{
+		$$ = new NClassDeclaration($3, $7, $1, $5);
+	}
 	;
 class_body
 	: ';'
@@ -273,6 +287,10 @@ struct_declaration
 	{
 		$$ = new NStructDeclaration($3, $4, $1, $2);
 	}
+	| optional_attribute_declaration struct_union_keyword TT_IDENTIFIER '<' generic_param_list '>' struct_body
+	{
+		$$ = new NStructDeclaration($3, $7, $1, $2, $5);
+	}
 	;
 struct_body
 	: ';'
@@ -313,6 +331,14 @@ function_declaration
 	{
 		$$ = new NFunctionDeclaration($3, $2, $5, $7, $1);
 	}
+	| data_type TT_IDENTIFIER '<' generic_param_list '>' '(' parameter_list ')' function_body
+	{
+		$$ = new NFunctionDeclaration($2, $1, $7, $9, nullptr, $4);
+	}
+	| attribute_declaration data_type TT_IDENTIFIER '<' generic_param_list '>' '(' parameter_list ')' function_body
+	{
+		$$ = new NFunctionDeclaration($3, $2, $8, $10, $1, $5);
+	}
 	;
 function_body
 	: compound_statement
@@ -387,10 +413,22 @@ statement
 	{
 		$$ = new NDeleteStatement($2);
 	}
+	| TT_YIELD ';'
+	{
+		$$ = new NYieldStatement($1.t_tok);
+	}
+	| TT_AWAIT expression ';'
+	{
+		$$ = new NAwaitStatement($1.t_tok, $2);
+	}
 	| TT_FOR '(' declaration_or_expression_list ';' expression_or_empty ';' expression_list ')' single_statement
 	{
 		$$ = new NForStatement($3, $5, $7, $9);
 	}
+	| attribute_declaration TT_FOR '(' declaration_or_expression_list ';' expression_or_empty ';' expression_list ')' single_statement
+	{
+		$$ = new NForStatement($4, $6, $8, $10, $1);
+	}
 	| TT_LOOP single_statement
 	{
 		$$ = new NLoopStatement($2);
@@ -547,6 +585,11 @@ variable
 	{
 		$$ = new NVariableDecl($1, $3);
 	}
+	| TT_IDENTIFIER ':' integer_constant
+	{
+		$$ = new NVariableDecl($1);
+		$$->setBitWidth($3);
+	}
 	;
 global_variable
 	: TT_IDENTIFIER
@@ -586,6 +629,10 @@ data_type
 	{
 		$$ = new NUserType($1);
 	}
+	| TT_IDENTIFIER '!' '<' data_type_list '>'
+	{
+		$$ = new NUserType($1, $4);
+	}
 	| TT_THIS
 	{
 		$$ = new NThisType($1);
@@ -597,6 +644,10 @@ explicit_data_type
 	{
 		$$ = new NConstType($1, $2);
 	}
+	| TT_ATOMIC data_type
+	{
+		$$ = new NAtomicType($1, $2);
+	}
 	| '[' expression ']' data_type
 	{
 		$$ = new NArrayType($1.t_tok, $4, $2);
@@ -634,6 +685,18 @@ data_type_list
 		$$ = $1;
 	}
 	;
+generic_param_list
+	: TT_IDENTIFIER
+	{
+		$$ = new NDataTypeList;
+		$$->add(new NUserType($1));
+	}
+	| generic_param_list ',' TT_IDENTIFIER
+	{
+		$1->add(new NUserType($3));
+		$$ = $1;
+	}
+	;
 base_type
 	: TT_AUTO   { $$ = new NBaseType($1, TT_AUTO);   }
 	| TT_VOID   { $$ = new NBaseType($1, TT_VOID);   }
@@ -726,6 +789,14 @@ new_expression
 	{
 		$$ = new NNewExpression($1.t_tok, $2, $4);
 	}
+	| TT_NEW '(' variable_expression ')' data_type
+	{
+		$$ = new NNewExpression($1.t_tok, $5, nullptr, $3);
+	}
+	| TT_NEW '(' variable_expression ')' data_type '{' expression_list '}'
+	{
+		$$ = new NNewExpression($1.t_tok, $5, $7, $3);
+	}
 	;
 logical_or_expression
 	: logical_and_expression
@@ -854,6 +925,10 @@ arrow_expression
 	{
 		$$ = new NArrowOperator($2, $5, $6);
 	}
+	| TT_ATOMIC TT_ARROW TT_IDENTIFIER '{' expression_list '}'
+	{
+		$$ = new NArrowOperator($1, $3, $5);
+	}
 	;
 arrow_argument
 	:
@@ -877,6 +952,10 @@ function_call
 	{
 		$$ = new NFunctionCall($1, $3);
 	}
+	| TT_IDENTIFIER '!' '<' data_type_list '>' '(' expression_list ')'
+	{
+		$$ = new NFunctionCall($1, $7, $4);
+	}
 	;
 increment_decrement_expression
 	: increment_decrement_operator variable_expression
@@ -929,6 +1008,10 @@ variable_expression
 	{
 		$$ = new NArrowOperator($1, $3, $4);
 	}
+	| variable_expression TT_ARROW TT_IDENTIFIER '{' expression_list '}'
+	{
+		$$ = new NArrowOperator($1, $3, $5);
+	}
 	| variable_expression '@'
 	{
 		$$ = new NDereference($1, $2.t_tok);
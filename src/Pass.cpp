@@ -16,12 +16,15 @@
  */
 
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Module.h>
 #include <llvm/IR/CFG.h>
 #include "Pass.h"
 
 using namespace std;
 
 char SimpleBlockClean::ID = 0;
+char HeapToStack::ID = 0;
 
 bool SimpleBlockClean::removeBranchBlock(BasicBlock* block)
 {
@@ -84,3 +87,132 @@ bool SimpleBlockClean::runOnFunction(Function &func)
 	}
 	return modified;
 }
+
+bool HeapToStack::inLoop(BasicBlock* block)
+{
+	set<BasicBlock*> seen;
+	vector<BasicBlock*> work(succ_begin(block), succ_end(block));
+	while (!work.empty()) {
+		auto next = work.back();
+		work.pop_back();
+		if (next == block)
+			return true;
+		else if (!seen.insert(next).second)
+			continue;
+		work.insert(work.end(), succ_begin(next), succ_end(next));
+	}
+	return false;
+}
+
+bool HeapToStack::callEscapes(CallInst* call, Value* ptr, vector<CallInst*>* frees, set<Value*>& visited, int depth)
+{
+	auto func = call->getCalledFunction();
+	if (!func || func == ptr) {
+		return true;
+	} else if (isa<DbgInfoIntrinsic>(call) || isa<MemIntrinsic>(call)) {
+		return false;
+	} else if (auto intr = dyn_cast<IntrinsicInst>(call)) {
+		auto id = intr->getIntrinsicID();
+		return id != Intrinsic::lifetime_start && id != Intrinsic::lifetime_end;
+	} else if (func->isDeclaration() && func->getName() == "free") {
+		// a free inside a callee would release the stack memory
+		if (!frees)
+			return true;
+		frees->push_back(call);
+		return false;
+	} else if (func->isDeclaration() || func->isVarArg() || depth >= MaxDepth) {
+		return true;
+	}
+
+	// follow the pointer into the callee's parameters
+	auto arg = func->arg_begin();
+	for (unsigned i = 0; i < call->getNumArgOperands(); i++, arg++) {
+		if (call->getArgOperand(i) == ptr && escapes(&*arg, nullptr, visited, depth + 1))
+			return true;
+	}
+	return false;
+}
+
+bool HeapToStack::escapes(Value* ptr, vector<CallInst*>* frees, set<Value*>& visited, int depth)
+{
+	if (!visited.insert(ptr).second)
+		return false;
+
+	for (auto user : ptr->users()) {
+		if (isa<BitCastInst>(user) || isa<GetElementPtrInst>(user)) {
+			if (escapes(user, frees, visited, depth))
+				return true;
+		} else if (isa<LoadInst>(user) || isa<ICmpInst>(user)) {
+			continue;
+		} else if (auto store = dyn_cast<StoreInst>(user)) {
+			// storing the pointer itself lets it outlive the function
+			if (store->getValueOperand() == ptr)
+				return true;
+		} else if (auto call = dyn_cast<CallInst>(user)) {
+			if (callEscapes(call, ptr, frees, visited, depth))
+				return true;
+		} else {
+			// returned, merged by a phi/select, or cast to an integer
+			return true;
+		}
+	}
+	return false;
+}
+
+bool HeapToStack::runOnFunction(Function &func)
+{
+	vector<CallInst*> mallocs;
+	for (auto& block : func) {
+		for (auto& inst : block) {
+			auto call = dyn_cast<CallInst>(&inst);
+			if (!call)
+				continue;
+			auto callee = call->getCalledFunction();
+			if (callee && callee->isDeclaration() && callee->getName() == "malloc" && call->getNumArgOperands() == 1)
+				mallocs.push_back(call);
+		}
+	}
+
+	bool modified = false;
+	for (auto call : mallocs) {
+		// a loop would reuse the same stack slot for every iteration
+		auto size = dyn_cast<ConstantInt>(call->getArgOperand(0));
+		if (!size || size->getZExtValue() > MaxSize || inLoop(call->getParent()))
+			continue;
+
+		vector<CallInst*> frees;
+		set<Value*> visited;
+		if (escapes(call, &frees, visited, 0))
+			continue;
+
+		auto insertPt = &*func.getEntryBlock().getFirstInsertionPt();
+		auto type = ArrayType::get(Type::getInt8Ty(func.getContext()), size->getZExtValue());
+#if LLVM_VERSION_MAJOR >= 5
+		auto addrSpace = func.getParent()->getDataLayout().getAllocaAddrSpace();
+		auto alloca = new AllocaInst(type, addrSpace, "", insertPt);
+#else
+		auto alloca = new AllocaInst(type, "", insertPt);
+#endif
+		// match the alignment malloc guarantees
+		alloca->setAlignment(16);
+		auto ptr = new BitCastInst(alloca, call->getType(), "", insertPt);
+
+		call->replaceAllUsesWith(ptr);
+		call->eraseFromParent();
+		for (auto free : frees)
+			free->eraseFromParent();
+		removed++;
+		modified = true;
+	}
+	return modified;
+}
+
+bool HeapToStack::runOnModule(Module &module)
+{
+	bool modified = false;
+	for (auto& func : module) {
+		if (!func.isDeclaration())
+			modified |= runOnFunction(func);
+	}
+	return modified;
+}
@@ -17,6 +17,9 @@
 #ifndef __PASS_H__
 #define __PASS_H__
 
+#include <set>
+#include <vector>
+#include <llvm/IR/Instructions.h>
 #include <llvm/Pass.h>
 
 using namespace llvm;
@@ -43,4 +46,42 @@ public:
 	bool runOnFunction(Function &func);
 };
 
+// replaces malloc calls whose pointer never leaves the function
+// with an entry-block alloca, and removes the matching free calls
+class HeapToStack : public ModulePass
+{
+	// largest allocation moved to the stack, in bytes
+	static const uint64_t MaxSize = 4096;
+
+	// how many calls deep a pointer argument is followed
+	static const int MaxDepth = 4;
+
+	unsigned& removed;
+
+	bool inLoop(BasicBlock* block);
+
+	bool callEscapes(CallInst* call, Value* ptr, std::vector<CallInst*>* frees, std::set<Value*>& visited, int depth);
+
+	bool escapes(Value* ptr, std::vector<CallInst*>* frees, std::set<Value*>& visited, int depth);
+
+	bool runOnFunction(Function &func);
+
+public:
+	static char ID;
+
+	explicit HeapToStack(unsigned& removed)
+	: ModulePass(ID), removed(removed) {}
+
+#if LLVM_VERSION_MAJOR >= 4
+	StringRef getPassName() const
+#else
+	const char* getPassName() const
+#endif
+	{
+		return "HeapToStack";
+	}
+
+	bool runOnModule(Module &module);
+};
+
 #endif
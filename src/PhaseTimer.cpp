@@ -0,0 +1,116 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sys/resource.h>
+#include "PhaseTimer.h"
+#include "SourceManager.h"
+
+bool PhaseTimer::enabled = false;
+PhaseTimer::clock::time_point PhaseTimer::start;
+map<string, double> PhaseTimer::phases;
+vector<pair<string, PhaseTimer::clock::time_point>> PhaseTimer::active;
+
+PhaseTimer::Scope::Scope(const string& phase)
+{
+	if (!enabled)
+		return;
+	auto now = clock::now();
+	charge(now);
+	active.push_back({phase, now});
+}
+
+PhaseTimer::Scope::~Scope()
+{
+	if (!enabled || active.empty())
+		return;
+	auto now = clock::now();
+	charge(now);
+	active.pop_back();
+	if (!active.empty())
+		active.back().second = now;
+}
+
+void PhaseTimer::charge(clock::time_point now)
+{
+	if (active.empty())
+		return;
+	auto& phase = active.back();
+	phases[phase.first] += chrono::duration<double>(now - phase.second).count();
+	phase.second = now;
+}
+
+void PhaseTimer::enable()
+{
+	enabled = true;
+	start = clock::now();
+	phases.clear();
+	active.clear();
+}
+
+static string quote(const string& str)
+{
+	string out = "\"";
+	for (auto c : str) {
+		if (c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+	return out + "\"";
+}
+
+void PhaseTimer::report(const string& output, const string& input, const set<boost::filesystem::path>& files)
+{
+	if (!enabled)
+		return;
+	auto now = clock::now();
+	charge(now);
+	chrono::duration<double> total = now - start;
+
+	size_t lines = 0, bytes = 0;
+	for (auto& file : files) {
+		auto source = SourceManager::get(file.string());
+		lines += count(source->data(), source->data() + source->size(), '\n');
+		bytes += source->size();
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	std::ofstream fileOut;
+	if (output != "-")
+		fileOut.open(output);
+	ostream& out = output != "-"? fileOut : cout;
+
+	out << "{\n"
+		<< "  \"input\": " << quote(input) << ",\n"
+		<< "  \"files\": " << files.size() << ",\n"
+		<< "  \"lines\": " << lines << ",\n"
+		<< "  \"bytes\": " << bytes << ",\n"
+		<< "  \"seconds\": " << total.count() << ",\n"
+		<< "  \"linesPerSecond\": " << (total.count() > 0? lines / total.count() : 0) << ",\n"
+		<< "  \"peakRssKB\": " << usage.ru_maxrss << ",\n"
+		<< "  \"phases\": {";
+	auto first = true;
+	for (auto& phase : phases) {
+		out << (first? "\n" : ",\n") << "    " << quote(phase.first) << ": " << phase.second;
+		first = false;
+	}
+	out << "\n  }\n}" << endl;
+	enabled = false;
+}
@@ -0,0 +1,67 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __PHASE_TIMER_H__
+#define __PHASE_TIMER_H__
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+using namespace std;
+
+/**
+ * Accumulates the time spent in each compiler phase for --time-phases.
+ * Phases nest: while an inner phase runs, the outer one is paused, so
+ * the phase times add up to the time spent inside any phase.
+ */
+class PhaseTimer
+{
+	typedef chrono::steady_clock clock;
+
+	static bool enabled;
+	static clock::time_point start;
+	static map<string, double> phases;
+	static vector<pair<string, clock::time_point>> active;
+
+	static void charge(clock::time_point now);
+
+public:
+	/**
+	 * Times the enclosing block as the given phase
+	 */
+	class Scope
+	{
+	public:
+		explicit Scope(const string& phase);
+
+		~Scope();
+	};
+
+	static void enable();
+
+	/**
+	 * Writes the phase times, throughput and peak memory use as JSON
+	 * to the given file, or stdout for "-". Timing stops until the
+	 * next enable().
+	 */
+	static void report(const string& output, const string& input, const set<boost::filesystem::path>& files);
+};
+
+#endif
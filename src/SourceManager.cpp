@@ -0,0 +1,105 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SourceManager.h"
+
+static const char emptyFile[SourceFile::Padding] = {0};
+
+SourceFile::SourceFile(const string& filename)
+: ptr(emptyFile), len(0), mapLen(0)
+{
+	auto fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+
+	struct stat info;
+	if (fstat(fd, &info) || !S_ISREG(info.st_mode) || !info.st_size) {
+		close(fd);
+		return;
+	}
+
+	// reserve zeroed pages for the padding, then map the file over the start
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t size = info.st_size;
+	size_t total = (size + Padding + page - 1) / page * page;
+	auto base = mmap(nullptr, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base != MAP_FAILED) {
+		auto view = mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+		if (view != MAP_FAILED) {
+			ptr = static_cast<const char*>(view);
+			len = size;
+			mapLen = total;
+			close(fd);
+			return;
+		}
+		munmap(base, total);
+	}
+
+	// fall back to reading the file when it can't be mapped
+	owned.reset(new char[size + Padding]());
+	size_t done = 0;
+	while (done < size) {
+		auto count = pread(fd, owned.get() + done, size - done, done);
+		if (count <= 0)
+			break;
+		done += count;
+	}
+	ptr = owned.get();
+	len = done;
+	close(fd);
+}
+
+SourceFile::SourceFile(const char* data, size_t size)
+: len(size), mapLen(0), owned(new char[size + Padding]())
+{
+	memcpy(owned.get(), data, size);
+	ptr = owned.get();
+}
+
+SourceFile::~SourceFile()
+{
+	if (mapLen)
+		munmap(const_cast<char*>(ptr), mapLen);
+}
+
+mutex SourceManager::lock;
+map<string, SourceFilePtr> SourceManager::files;
+
+SourceFilePtr SourceManager::get(const string& filename)
+{
+	lock_guard<mutex> guard(lock);
+	auto& file = files[filename];
+	if (!file)
+		file = make_shared<const SourceFile>(filename);
+	return file;
+}
+
+void SourceManager::clear()
+{
+	lock_guard<mutex> guard(lock);
+	files.clear();
+}
+
+void SourceManager::release(const string& filename)
+{
+	lock_guard<mutex> guard(lock);
+	files.erase(filename);
+}
@@ -0,0 +1,95 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __SOURCE_MANAGER_H__
+#define __SOURCE_MANAGER_H__
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+/**
+ * A read-only memory mapping of a source file. The mapping is followed by
+ * at least Padding zero bytes so that vector loads past the end of the
+ * file stay inside the mapping.
+ */
+class SourceFile
+{
+	const char* ptr;
+	size_t len;
+	size_t mapLen;
+	unique_ptr<char[]> owned;
+
+	SourceFile(const SourceFile&) = delete;
+	SourceFile& operator=(const SourceFile&) = delete;
+
+public:
+	static const size_t Padding = 64;
+
+	explicit SourceFile(const string& filename);
+
+	// copies an in-memory buffer, such as part of an edited file
+	SourceFile(const char* data, size_t size);
+
+	~SourceFile();
+
+	const char* data() const
+	{
+		return ptr;
+	}
+
+	size_t size() const
+	{
+		return len;
+	}
+};
+
+typedef shared_ptr<const SourceFile> SourceFilePtr;
+
+/**
+ * Maps each source file once per compile, so the main file and every
+ * import share a single mapping between the lexer and the compile cache.
+ */
+class SourceManager
+{
+	static mutex lock;
+	static map<string, SourceFilePtr> files;
+
+public:
+	/**
+	 * Releases every mapping when the compile ends
+	 */
+	class Scope
+	{
+	public:
+		~Scope()
+		{
+			SourceManager::clear();
+		}
+	};
+
+	static SourceFilePtr get(const string& filename);
+
+	static void clear();
+
+	// drops a single mapping, for tools that handle many files in one run
+	static void release(const string& filename);
+};
+
+#endif
@@ -14,6 +14,7 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <algorithm>
 #include "CodeContext.h"
 
 #define smart_stype(tclass, type, size, subtype) unique_ptr<SType>(new SType(tclass, type, size, subtype))
@@ -75,6 +76,16 @@ SType* SType::getMutable(CodeContext& context, SType* type)
 	return context.typeManager.getMutable(type);
 }
 
+SType* SType::getAtomic(CodeContext& context, SType* type)
+{
+	return context.typeManager.getAtomic(type);
+}
+
+SType* SType::getNonAtomic(CodeContext& context, SType* type)
+{
+	return context.typeManager.getNonAtomic(type);
+}
+
 SType* SType::getVoid(CodeContext& context)
 {
 	return context.typeManager.getVoid();
@@ -115,11 +126,21 @@ SFunctionType* SType::getFunction(CodeContext& context, SType* returnTy, vector<
 	return context.typeManager.getFunction(returnTy, params);
 }
 
+SType* SType::getBitField(CodeContext& context, SType* type, int width)
+{
+	return context.typeManager.getBitField(type, width);
+}
+
 uint64_t SType::allocSize(CodeContext& context, SType* type)
 {
 	return context.typeManager.allocSize(type);
 }
 
+uint64_t SType::customAlign(CodeContext& context, SType* type)
+{
+	return context.typeManager.customAlign(type);
+}
+
 SType* SType::numericConv(CodeContext& context, Token* optToken, SType* ltype, SType* rtype, bool int32min)
 {
 	switch (ltype->isVec() | (rtype->isVec() << 1)) {
@@ -174,11 +195,27 @@ void SUserType::innerStr(CodeContext* context, stringstream& os) const
 }
 
 SStructType::SStructType(StructType* type, const vector<pair<string, SType*>>& structure, int ctype)
-: SUserType(ctype | (structure.size()? 0 : OPAQUE), type, structure.size())
+: SUserType(ctype | OPAQUE, type)
+{
+	setMembers(structure);
+}
+
+void SStructType::setMembers(const vector<pair<string, SType*>>& structure)
 {
+	items.clear();
 	int i = 0;
 	for (auto var : structure)
 		items[var.first] = make_pair(i++, RValue(nullptr, var.second));
+	tsize = structure.size();
+	if (structure.size())
+		tclass &= ~OPAQUE;
+}
+
+void SStructType::setLayout(const vector<int>& indexes, uint64_t alignment)
+{
+	for (auto& item : items)
+		item.second.first = indexes[item.second.first];
+	align = alignment;
 }
 
 pair<int, RValue>* SStructType::getItem(const string& name)
@@ -256,14 +293,19 @@ void SUserType::createAlias(CodeContext& context, const string& name, SType* typ
 	context.typeManager.createAlias(name, type);
 }
 
-void SUserType::createStruct(CodeContext& context, const string& name, const vector<pair<string, SType*>>& structure)
+void SUserType::declareStruct(CodeContext& context, const string& name, bool isClass)
+{
+	context.typeManager.declareStruct(name, isClass);
+}
+
+void SUserType::createStruct(CodeContext& context, const string& name, const vector<pair<string, SType*>>& structure, const SStructLayout& layout)
 {
-	context.typeManager.createStruct(name, structure);
+	context.typeManager.createStruct(name, structure, layout);
 }
 
-void SUserType::createClass(CodeContext& context, const string& name, const vector<pair<string, SType*>>& structure)
+void SUserType::createClass(CodeContext& context, const string& name, const vector<pair<string, SType*>>& structure, const SStructLayout& layout)
 {
-	context.typeManager.createClass(name, structure);
+	context.typeManager.createClass(name, structure, layout);
 }
 
 void SUserType::createUnion(CodeContext& context, const string& name, const vector<pair<string, SType*>>& structure)
@@ -332,6 +374,16 @@ SFunctionType* TypeManager::getFunction(SType* returnTy, vector<SType*> args)
 	return item.get();
 }
 
+SType* TypeManager::getBitField(SType* type, int width, Type* storage, int offset)
+{
+	if (!storage)
+		storage = *type;
+	STypePtr &item = bitMap[make_tuple(type, storage, width, offset)];
+	if (!item.get())
+		item = unique_ptr<SType>(new SBitFieldType(type, storage, width, offset));
+	return item.get();
+}
+
 void TypeManager::createAlias(const string& name, SType* type)
 {
 	SUserPtr& item = usrMap[name];
@@ -340,30 +392,160 @@ void TypeManager::createAlias(const string& name, SType* type)
 	item = smart_aliasTy(type);
 }
 
-StructType* TypeManager::buildStruct(const string& name, const vector<pair<string, SType*>>& structure)
+uint64_t TypeManager::customAlign(SType* stype)
+{
+	while (stype->isArray())
+		stype = stype->subType();
+	return stype->isStruct()? static_cast<SStructType*>(stype)->getAlign() : 0;
+}
+
+static void addPadding(vector<Type*>& elements, Type* int8, uint64_t& offset, uint64_t align)
 {
+	auto pad = (align - offset % align) % align;
+	if (pad)
+		elements.push_back(ArrayType::get(int8, pad));
+	offset += pad;
+}
+
+StructType* TypeManager::buildStruct(const string& name, vector<pair<string, SType*>>& structure, const SStructLayout& layout, vector<int>& indexes, uint64_t& align, StructType* declared)
+{
+	// each slot becomes one element: a member, or a run of
+	// consecutive bit-fields sharing a storage unit of up to 64 bits
+	vector<vector<int>> slots;
+	vector<SType*> slotTypes;
+	int bits = -1;
+	for (size_t i = 0; i < structure.size(); i++) {
+		auto type = structure[i].second;
+		if (!type->isBitField()) {
+			slots.push_back({(int) i});
+			slotTypes.push_back(type);
+			bits = -1;
+			continue;
+		}
+		int width = type->size();
+		if (bits < 0 || bits + width > 64) {
+			slots.push_back({});
+			slotTypes.push_back(nullptr);
+			bits = 0;
+		}
+		slots.back().push_back(i);
+		structure[i].second = getBitField(type->subType(), width, nullptr, bits);
+		bits += width;
+	}
+	for (size_t i = 0; i < slots.size(); i++) {
+		if (slotTypes[i])
+			continue;
+		auto last = structure[slots[i].back()].second;
+		auto used = static_cast<SBitFieldType*>(last)->getOffset() + last->size();
+		uint64_t unitBits = 8;
+		while (unitBits < used)
+			unitBits *= 2;
+		slotTypes[i] = getInt(unitBits, true);
+		for (auto member : slots[i]) {
+			auto& item = structure[member];
+			auto field = static_cast<SBitFieldType*>(item.second);
+			item.second = getBitField(field->subType(), field->size(), *slotTypes[i], field->getOffset());
+		}
+	}
+
+	vector<int> order;
+	for (size_t i = 0; i < slots.size(); i++)
+		order.push_back(i);
+	if (layout.reorder) {
+		// largest alignment first leaves the least padding
+		stable_sort(order.begin(), order.end(), [&](int a, int b){
+			return alignOf(slotTypes[a]) > alignOf(slotTypes[b]);
+		});
+	}
+
+	// #[align] and over-aligned members need a packed struct with explicit padding
+	auto padded = layout.align > 0;
+	for (auto type : slotTypes)
+		padded |= customAlign(type) > 0;
+	padded &= !layout.packed;
+
+	// an empty struct still takes one byte
 	vector<Type*> elements;
-	if (structure.empty())
+	uint64_t offset = 0;
+	if (structure.empty()) {
 		elements.push_back(*int8Ty.get());
-	for (auto item : structure)
-		elements.push_back(*item.second);
-	return StructType::create(elements, name);
+		offset = 1;
+	}
+	indexes.assign(structure.size(), 0);
+	align = padded? max<uint64_t>(layout.align, 1) : 0;
+	for (auto i : order) {
+		auto type = slotTypes[i];
+		if (padded) {
+			auto itemAlign = alignOf(type);
+			align = max(align, itemAlign);
+			addPadding(elements, *int8Ty.get(), offset, itemAlign);
+			offset += allocSize(type);
+		}
+		for (auto member : slots[i])
+			indexes[member] = elements.size();
+		elements.push_back(*type);
+	}
+	if (padded)
+		addPadding(elements, *int8Ty.get(), offset, align);
+	if (!declared)
+		return StructType::create(elements, name, layout.packed || padded);
+	declared->setBody(elements, layout.packed || padded);
+	return declared;
 }
 
-void TypeManager::createStruct(const string& name, const vector<pair<string, SType*>>& structure)
+void TypeManager::declareStruct(const string& name, bool isClass)
 {
 	SUserPtr& item = usrMap[name];
 	if (item.get())
 		return;
-	item = smart_strucTy(buildStruct(name, structure), structure);
+	auto type = StructType::create(int8Ty->type()->getContext(), name);
+	vector<pair<string, SType*>> none;
+	item = isClass? smart_classTy(type, none) : smart_strucTy(type, none);
 }
 
-void TypeManager::createClass(const string& name, const vector<pair<string, SType*>>& structure)
+// returns the opaque struct left by declareStruct, completed in place
+// because its members may already point to it
+SStructType* TypeManager::getDeclared(const string& name, bool isClass)
 {
+	auto item = usrMap[name].get();
+	if (!item || !item->isOpaque() || !item->isStruct() || item->isClass() != isClass)
+		return nullptr;
+	auto type = static_cast<StructType*>(item->type());
+	return type->isOpaque()? static_cast<SStructType*>(item) : nullptr;
+}
+
+void TypeManager::createStruct(const string& name, const vector<pair<string, SType*>>& structure, const SStructLayout& layout)
+{
+	auto declared = getDeclared(name, false);
 	SUserPtr& item = usrMap[name];
-	if (item.get())
+	if (item.get() && !declared)
 		return;
-	item = smart_classTy(buildStruct(name, structure), structure);
+	vector<int> indexes;
+	uint64_t align;
+	auto members = structure;
+	auto type = buildStruct(name, members, layout, indexes, align, declared? static_cast<StructType*>(declared->type()) : nullptr);
+	if (declared)
+		declared->setMembers(members);
+	else
+		item = smart_strucTy(type, members);
+	static_cast<SStructType*>(item.get())->setLayout(indexes, align);
+}
+
+void TypeManager::createClass(const string& name, const vector<pair<string, SType*>>& structure, const SStructLayout& layout)
+{
+	auto declared = getDeclared(name, true);
+	SUserPtr& item = usrMap[name];
+	if (item.get() && !declared)
+		return;
+	vector<int> indexes;
+	uint64_t align;
+	auto members = structure;
+	auto type = buildStruct(name, members, layout, indexes, align, declared? static_cast<StructType*>(declared->type()) : nullptr);
+	if (declared)
+		declared->setMembers(members);
+	else
+		item = smart_classTy(type, members);
+	static_cast<SStructType*>(item.get())->setLayout(indexes, align);
 }
 
 void TypeManager::createUnion(const string& name, const vector<pair<string, SType*>>& structure)
@@ -18,6 +18,7 @@
 #define __TYPE_H__
 
 #include <map>
+#include <tuple>
 #include <llvm/IR/DataLayout.h>
 #include <llvm/ADT/APSInt.h>
 #include <llvm/Support/raw_ostream.h>
@@ -35,6 +36,14 @@ class TypeManager;
 using namespace std;
 using namespace llvm;
 
+// layout attributes of a struct or class
+struct SStructLayout
+{
+	bool packed = false;
+	bool reorder = false;
+	uint64_t align = 0;
+};
+
 class SType
 {
 protected:
@@ -77,7 +86,9 @@ public:
 		ALIAS    = 1 << 13,
 		CLASS    = 1 << 14,
 		OPAQUE   = 1 << 15,
-		CONST    = 1 << 16
+		CONST    = 1 << 16,
+		ATOMIC   = 1 << 17,
+		BITFIELD = 1 << 18
 	};
 
 	static vector<Type*> convertArr(vector<SType*> arr)
@@ -112,6 +123,9 @@ public:
 
 	static uint64_t allocSize(CodeContext& context, SType* type);
 
+	// alignment from #[align], or 0 if the type is naturally aligned
+	static uint64_t customAlign(CodeContext& context, SType* type);
+
 	static SType* numericConv(CodeContext& context, Token* optToken, SType* ltype, SType* rtype, bool int32min = true);
 
 	static SType* getAuto(CodeContext& context);
@@ -120,6 +134,10 @@ public:
 
 	static SType* getMutable(CodeContext& context, SType* type);
 
+	static SType* getAtomic(CodeContext& context, SType* type);
+
+	static SType* getNonAtomic(CodeContext& context, SType* type);
+
 	static SType* getVoid(CodeContext& context);
 
 	static SType* getBool(CodeContext& context);
@@ -136,6 +154,8 @@ public:
 
 	static SFunctionType* getFunction(CodeContext& context, SType* returnTy, vector<SType*> params);
 
+	static SType* getBitField(CodeContext& context, SType* type, int width);
+
 	operator Type*() const
 	{
 		return ltype;
@@ -161,6 +181,16 @@ public:
 		return tclass & CONST;
 	}
 
+	bool isAtomic() const
+	{
+		return tclass & ATOMIC;
+	}
+
+	bool isBitField() const
+	{
+		return tclass & BITFIELD;
+	}
+
 	bool isVoid() const
 	{
 		return tclass & VOID;
@@ -280,6 +310,8 @@ public:
 		string s;
 		raw_string_ostream os(s);
 
+		if (isAtomic())
+			os << "atomic ";
 		if (isArray()) {
 			if (isConst())
 				os << "const";
@@ -354,9 +386,12 @@ public:
 
 	static void createAlias(CodeContext& context, const string& name, SType* type);
 
-	static void createStruct(CodeContext& context, const string& name, const vector<pair<string, SType*>>& structure);
+	// declares an opaque struct or class that a later createStruct or createClass completes
+	static void declareStruct(CodeContext& context, const string& name, bool isClass);
 
-	static void createClass(CodeContext& context, const string& name, const vector<pair<string, SType*>>& structure);
+	static void createStruct(CodeContext& context, const string& name, const vector<pair<string, SType*>>& structure, const SStructLayout& layout = SStructLayout());
+
+	static void createClass(CodeContext& context, const string& name, const vector<pair<string, SType*>>& structure, const SStructLayout& layout = SStructLayout());
 
 	static void createUnion(CodeContext& context, const string& name, const vector<pair<string, SType*>>& structure);
 
@@ -391,8 +426,15 @@ class SStructType : public SUserType
 protected:
 	container items;
 
+	// explicit alignment when the layout was padded by hand
+	uint64_t align = 0;
+
 	SStructType(StructType* type, const vector<pair<string, SType*>>& structure, int ctype = STRUCT);
 
+	void setMembers(const vector<pair<string, SType*>>& structure);
+
+	void setLayout(const vector<int>& indexes, uint64_t alignment);
+
 	SType* copy()
 	{
 		return new SStructType(*this);
@@ -403,6 +445,11 @@ protected:
 public:
 	pair<int, RValue>* getItem(const string& name);
 
+	uint64_t getAlign() const
+	{
+		return align;
+	}
+
 	string str(CodeContext* context = nullptr) const;
 
 	const_iterator begin() const
@@ -420,11 +467,24 @@ class SClassType : public SStructType
 {
 	friend class TypeManager;
 
+	// class providing allocate/deallocate for new and delete
+	string allocator;
+
 	SClassType(StructType* type, const vector<pair<string, SType*>>& structure)
 	: SStructType(type, structure, STRUCT | CLASS) {}
 
 public:
 	void addFunction(const string& name, const SFunction& func);
+
+	void setAllocator(const string& name)
+	{
+		allocator = name;
+	}
+
+	const string& getAllocator() const
+	{
+		return allocator;
+	}
 };
 
 class SUnionType : public SUserType
@@ -546,6 +606,34 @@ public:
 	}
 };
 
+class SBitFieldType : public SType
+{
+	friend class TypeManager;
+
+	// bit position of the field within its storage unit
+	int offset;
+
+	SBitFieldType(SType* type, Type* storage, int width, int offset)
+	: SType(BITFIELD, storage, width, type), offset(offset) {}
+
+	SType* copy()
+	{
+		return new SBitFieldType(*this);
+	}
+
+public:
+	int getOffset() const
+	{
+		return offset;
+	}
+
+	string str(CodeContext* context = nullptr) const
+	{
+		auto s = (isConst()? "const " : "") + subtype->str(context);
+		return context? s : s + ":" + to_string(size());
+	}
+};
+
 class TypeManager
 {
 	using STypePtr = unique_ptr<SType>;
@@ -564,6 +652,10 @@ class TypeManager
 	// mutable type
 	map<SType*, SType*> mutMap;
 
+	// atomic types
+	map<SType*, STypePtr> atomicMap;
+	map<SType*, SType*> nonAtomicMap;
+
 	// array & vec types
 	map<pair<SType*, uint64_t>, STypePtr> arrMap;
 	map<pair<SType*, uint64_t>, STypePtr> vecMap;
@@ -577,7 +669,12 @@ class TypeManager
 	// function types
 	map<pair<SType*, vector<SType*> >, SFuncPtr> funcMap;
 
-	StructType* buildStruct(const string& name, const vector<pair<string, SType*>>& structure);
+	// bit-field types
+	map<tuple<SType*, Type*, int, int>, STypePtr> bitMap;
+
+	StructType* buildStruct(const string& name, vector<pair<string, SType*>>& structure, const SStructLayout& layout, vector<int>& indexes, uint64_t& align, StructType* declared);
+
+	SStructType* getDeclared(const string& name, bool isClass);
 
 public:
 	explicit TypeManager(Module* module);
@@ -587,6 +684,14 @@ public:
 		return datalayout.getTypeAllocSize(*stype);
 	}
 
+	uint64_t customAlign(SType* stype);
+
+	uint64_t alignOf(SType* stype)
+	{
+		auto align = customAlign(stype);
+		return align? align : datalayout.getABITypeAlignment(*stype);
+	}
+
 	SType* getAuto() const
 	{
 		return autoTy.get();
@@ -640,6 +745,31 @@ public:
 		return mutMap[type];
 	}
 
+	SType* getAtomic(SType* type)
+	{
+		if (!type || type->isAtomic())
+			return type;
+		else if (type->isConst())
+			// keep const as the outer qualifier so getMutable works
+			return getConst(getAtomic(getMutable(type)));
+		STypePtr &item = atomicMap[type];
+		if (!item.get()) {
+			item = unique_ptr<SType>(type->copy());
+			item->tclass |= SType::ATOMIC;
+			nonAtomicMap[item.get()] = type;
+		}
+		return item.get();
+	}
+
+	SType* getNonAtomic(SType* type)
+	{
+		if (!type || !type->isAtomic())
+			return type;
+		else if (type->isConst())
+			return getConst(getNonAtomic(getMutable(type)));
+		return nonAtomicMap[type];
+	}
+
 	SType* getArray(SType* arrType, int64_t size);
 
 	SType* getVec(SType* vecType, int64_t size);
@@ -648,6 +778,8 @@ public:
 
 	SFunctionType* getFunction(SType* returnTy, vector<SType*> args);
 
+	SType* getBitField(SType* type, int width, Type* storage = nullptr, int offset = 0);
+
 	SUserType* lookupUserType(const string& name)
 	{
 		return usrMap[name].get();
@@ -664,9 +796,11 @@ public:
 
 	void createAlias(const string& name, SType* type);
 
-	void createStruct(const string& name, const vector<pair<string, SType*>>& structure);
+	void declareStruct(const string& name, bool isClass);
+
+	void createStruct(const string& name, const vector<pair<string, SType*>>& structure, const SStructLayout& layout);
 
-	void createClass(const string& name, const vector<pair<string, SType*>>& structure);
+	void createClass(const string& name, const vector<pair<string, SType*>>& structure, const SStructLayout& layout);
 
 	void createUnion(const string& name, const vector<pair<string, SType*>>& structure);
 
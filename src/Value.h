@@ -155,6 +155,11 @@ public:
 		return NAttributeList::find(attrs(), "static");
 	}
 
+	bool isConstexpr() const
+	{
+		return NAttributeList::find(attrs(), "constexpr");
+	}
+
 	int size() const
 	{
 		return funcValue()->size();
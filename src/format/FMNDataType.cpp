@@ -18,6 +18,7 @@
 #include "../AST.h"
 #include "../parserbase.h"
 #include "FormatContext.h"
+#include "WriterUtil.h"
 #include "FMNDataType.h"
 #include "FMNExpression.h"
 
@@ -25,6 +26,7 @@ string FMNDataType::visit(NDataType* type)
 {
 	switch (type->id()) {
 	VISIT_CASE_RETURN(NArrayType, type)
+	VISIT_CASE_RETURN(NAtomicType, type)
 	VISIT_CASE_RETURN(NBaseType, type)
 	VISIT_CASE_RETURN(NConstType, type)
 	VISIT_CASE_RETURN(NFuncPointerType, type)
@@ -80,6 +82,11 @@ string FMNDataType::visitNConstType(NConstType* type)
 	return "const " + visit(type->getType());
 }
 
+string FMNDataType::visitNAtomicType(NAtomicType* type)
+{
+	return "atomic " + visit(type->getType());
+}
+
 string FMNDataType::visitNThisType(NThisType* type)
 {
 	return "this";
@@ -99,6 +106,8 @@ string FMNDataType::visitNVecType(NVecType* type)
 
 string FMNDataType::visitNUserType(NUserType* type)
 {
+	if (type->getGenericArgs())
+		return type->getName()->str + "!" + WriterUtil::typeList(context, type->getGenericArgs());
 	return type->getName()->str;
 }
 
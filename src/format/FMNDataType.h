@@ -29,6 +29,8 @@ private:
 
 	string visitNConstType(NConstType* type);
 
+	string visitNAtomicType(NAtomicType* type);
+
 	string visitNThisType(NThisType* type);
 
 	string visitNArrayType(NArrayType* type);
@@ -18,6 +18,7 @@
 #include "../AST.h"
 #include "../parserbase.h"
 #include "FormatContext.h"
+#include "WriterUtil.h"
 #include "FMNExpression.h"
 #include "FMNDataType.h"
 
@@ -93,13 +94,17 @@ string FMNExpression::visitNArrowOperator(NArrowOperator* exp)
 			return line;
 		line += FMNDataType::run(context, type);
 		break;
-	case NArrowOperator::EXP:
+	case NArrowOperator::EXP: {
 		auto ex = exp->getExp();
 		if (!ex)
 			return line;
 		line += visit(ex);
 		break;
 	}
+	case NArrowOperator::ATOMIC:
+		line += "atomic";
+		break;
+	}
 	line += "->" + exp->getName()->str;
 	auto args = exp->getArgs();
 	if (args) {
@@ -108,6 +113,9 @@ string FMNExpression::visitNArrowOperator(NArrowOperator* exp)
 			line += FMNDataType::run(context, arg);
 		line += ")";
 	}
+	auto expArgs = exp->getExpArgs();
+	if (expArgs)
+		line += "{" + visit(expArgs) + "}";
 	return line;
 }
 
@@ -169,7 +177,10 @@ string FMNExpression::visitNTernaryOperator(NTernaryOperator* exp)
 
 string FMNExpression::visitNNewExpression(NNewExpression* exp)
 {
-	string line = "new " + FMNDataType::run(context, exp->getType());
+	string line = "new ";
+	if (exp->getArena())
+		line += "(" + visit(exp->getArena()) + ") ";
+	line += FMNDataType::run(context, exp->getType());
 	auto args = exp->getArgs();
 	if (args) {
 		line += "{" + FMNExpression::run(context, args) + "}";
@@ -246,6 +257,8 @@ string FMNExpression::visitNUnaryMathOperator(NUnaryMathOperator* exp)
 string FMNExpression::visitNFunctionCall(NFunctionCall* exp)
 {
 	string ret = exp->getName()->str;
+	if (exp->getGenericArgs())
+		ret += "!" + WriterUtil::typeList(context, exp->getGenericArgs());
 	ret += "(";
 	bool last = false;
 	for (auto arg : *exp->getArguments()) {
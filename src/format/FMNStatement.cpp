@@ -29,6 +29,7 @@ void FMNStatement::visit(NStatement* stm)
 {
 	switch (stm->id()) {
 	VISIT_CASE(NAliasDeclaration, stm)
+	VISIT_CASE(NAwaitStatement, stm)
 	VISIT_CASE(NClassConstructor, stm)
 	VISIT_CASE(NClassDeclaration, stm)
 	VISIT_CASE(NClassDestructor, stm)
@@ -51,6 +52,7 @@ void FMNStatement::visit(NStatement* stm)
 	VISIT_CASE(NSwitchStatement, stm)
 	VISIT_CASE(NVariableDeclGroup, stm)
 	VISIT_CASE(NWhileStatement, stm)
+	VISIT_CASE(NYieldStatement, stm)
 	default:
 		cout << "NodeId::" << static_cast<int>(stm->id()) << " unrecognized in FMNStatement" << endl;
 	}
@@ -74,6 +76,7 @@ void FMNStatement::visitNExpressionStm(NExpressionStm* stm)
 
 void FMNStatement::visitNVariableDeclGroup(NVariableDeclGroup* stm)
 {
+	WriterUtil::writeAttr(context, stm->getAttrs());
 	auto line = FMNDataType::run(context, stm->getType()) + " ";
 	bool first = true;
 	for (auto var : *stm->getVars()) {
@@ -82,7 +85,9 @@ void FMNStatement::visitNVariableDeclGroup(NVariableDeclGroup* stm)
 		first = false;
 		line += var->getName()->str;
 
-		if (var->getInitExp()) {
+		if (var->getBitWidth()) {
+			line += " : " + FMNExpression::run(context, var->getBitWidth());
+		} else if (var->getInitExp()) {
 			line += " = " + FMNExpression::run(context, var->getInitExp());
 		} else if (var->getInitList()) {
 			line += "{" + FMNExpression::run(context, var->getInitList()) + "}";
@@ -113,7 +118,7 @@ void FMNStatement::visitNStructDeclaration(NStructDeclaration* stm)
 		type = "union";
 		break;
 	}
-	context.addLine(type + " " + stm->getName()->str);
+	context.addLine(type + " " + stm->getName()->str + WriterUtil::typeList(context, stm->getGenericParams()));
 	if (!stm->getVars()) {
 		context.add(";");
 		return;
@@ -155,7 +160,8 @@ void FMNStatement::visitNEnumDeclaration(NEnumDeclaration* stm)
 
 void FMNStatement::visitNFunctionDeclaration(NFunctionDeclaration* stm)
 {
-	WriterUtil::writeFunctionDecl(stm->getName()->str, stm->getAttrs(), stm->getRType(), stm->getParams(), nullptr, stm->getBody(), context);
+	auto name = stm->getName()->str + WriterUtil::typeList(context, stm->getGenericParams());
+	WriterUtil::writeFunctionDecl(name, stm->getAttrs(), stm->getRType(), stm->getParams(), nullptr, stm->getBody(), context);
 }
 
 void FMNStatement::visitNClassStructDecl(NClassStructDecl* stm)
@@ -189,7 +195,7 @@ void FMNStatement::visitNClassDeclaration(NClassDeclaration* stm)
 {
 	context.addLine("");;
 	WriterUtil::writeAttr(context, stm->getAttrs());
-	context.addLine("class " + stm->getName()->str);
+	context.addLine("class " + stm->getName()->str + WriterUtil::typeList(context, stm->getGenericParams()));
 	if (!stm->getMembers()) {
 		context.add(";");
 		return;
@@ -209,6 +215,16 @@ void FMNStatement::visitNReturnStatement(NReturnStatement* stm)
 	context.addLine("return " + val + ";");
 }
 
+void FMNStatement::visitNYieldStatement(NYieldStatement* stm)
+{
+	context.addLine("yield;");
+}
+
+void FMNStatement::visitNAwaitStatement(NAwaitStatement* stm)
+{
+	context.addLine("await " + FMNExpression::run(context, stm->getExp()) + ";");
+}
+
 void FMNStatement::visitNLoopStatement(NLoopStatement* stm)
 {
 	auto expr = FMNExpression::run(context, stm->getCond());
@@ -257,10 +273,13 @@ void FMNStatement::visitNSwitchStatement(NSwitchStatement* stm)
 void FMNStatement::visitNForStatement(NForStatement* stm)
 {
 	vector<string> lines;
-	context.setBuffer(&lines);
-	visit(stm->getPreStm());
-	context.setBuffer(nullptr);
+	{
+		FormatContext::LookAhead preStm(context);
+		visit(stm->getPreStm());
+		lines.swap(preStm.lines);
+	}
 
+	WriterUtil::writeAttr(context, stm->getAttrs());
 	context.addLine("for (");
 	context.add(accumulate(lines.begin(), lines.end(), string(), [](string& a, string& b) {
 		b.erase(b.begin(), find_if(b.begin(), b.end(), [](int ch) {
@@ -47,6 +47,10 @@ class FMNStatement
 
 	void visitNReturnStatement(NReturnStatement* stm);
 
+	void visitNYieldStatement(NYieldStatement* stm);
+
+	void visitNAwaitStatement(NAwaitStatement* stm);
+
 	void visitNLoopStatement(NLoopStatement* stm);
 
 	void visitNWhileStatement(NWhileStatement* stm);
@@ -19,59 +19,109 @@
 
 class FormatContext
 {
-	vector<string> lines;
+	static const size_t FlushSize = 64 * 1024;
+
+	ostream& output;
+	string buffer;
+	string line;
+	string indentStr;
 	vector<string>* altLines = nullptr;
-	int indentLvl = 0;
+	bool hasLine = false;
 
-	string indentLine() const
+	void endLine()
 	{
-		string r;
-		for (int i = 0; i < indentLvl; i++)
-			r += "\t";
-		return r;
+		if (!hasLine)
+			return;
+		buffer += line;
+		buffer += '\n';
+		line.clear();
+		if (buffer.size() >= FlushSize)
+			flush();
+	}
+
+	void flush()
+	{
+		output.write(buffer.data(), buffer.size());
+		buffer.clear();
 	}
 
 public:
+	/**
+	 * Captures the lines written while in scope instead of sending them to
+	 * the output, so a caller can rewrite them before emitting.
+	 */
+	class LookAhead
+	{
+		FormatContext& context;
+		vector<string>* prevLines;
 
-	void addLine(const string& line)
+	public:
+		vector<string> lines;
+
+		explicit LookAhead(FormatContext& context)
+		: context(context), prevLines(context.altLines)
+		{
+			context.altLines = &lines;
+		}
+
+		~LookAhead()
+		{
+			context.altLines = prevLines;
+		}
+	};
+
+	explicit FormatContext(ostream& output = cout)
+	: output(output)
 	{
-		(altLines ? *altLines : lines).push_back(indentLine() + line);
+		buffer.reserve(FlushSize + 4096);
 	}
 
-	void add(const string& str)
+	void addLine(const string& str)
 	{
-		(altLines ? *altLines : lines).back() += str;
+		if (altLines) {
+			altLines->push_back(indentStr + str);
+			return;
+		}
+		endLine();
+		line = indentStr;
+		line += str;
+		hasLine = true;
 	}
 
-	void setBuffer(vector<string>* alt)
+	void add(const string& str)
 	{
-		altLines = alt;
+		if (altLines)
+			altLines->back() += str;
+		else
+			line += str;
 	}
 
 	int getIndent() const
 	{
-		return indentLvl;
+		return indentStr.size();
 	}
 
 	void setIndent(int indent)
 	{
-		indentLvl = indent;
+		indentStr.assign(indent, '\t');
 	}
 
 	void indent()
 	{
-		indentLvl++;
+		indentStr += '\t';
 	}
 
 	void undent()
 	{
-		indentLvl--;
+		indentStr.pop_back();
 	}
 
 	void print()
 	{
-		for (string l : lines)
-			cout << l << endl;
+		endLine();
+		hasLine = false;
+		flush();
+		output.flush();
 	}
 };
 
@@ -76,6 +76,24 @@ void WriterUtil::writeBlockStmt(FormatContext& context, NStatementList* stmts, b
 		context.addLine("}");
 }
 
+string WriterUtil::typeList(FormatContext& context, NDataTypeList* types)
+{
+	if (!types)
+		return "";
+	string ret = "<";
+	bool first = true;
+	for (auto type : *types) {
+		if (!first)
+			ret += ", ";
+		first = false;
+		ret += FMNDataType::run(context, type);
+	}
+	// '>>' is the shift operator
+	if (ret.back() == '>')
+		ret += " ";
+	return ret + ">";
+}
+
 void WriterUtil::writeFunctionDecl(const string& name, NAttributeList* attrs, NDataType* rtype, NParameterList* params, NInitializerList* initList, NStatementList* body, FormatContext& context)
 {
 	context.addLine("");
@@ -26,6 +26,8 @@ public:
 
 	static void writeBlockStmt(FormatContext& context, NStatementList* stmts, bool forceBlock = false);
 
+	static string typeList(FormatContext& context, NDataTypeList* types);
+
 	static void writeFunctionDecl(const string& name, NAttributeList* attrs, NDataType* rtype, NParameterList* params, NInitializerList* initList, NStatementList* body, FormatContext& context);
 };
 
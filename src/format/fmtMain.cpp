@@ -15,9 +15,18 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <boost/program_options.hpp>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
 #include "../parser.h"
 #include "../AST.h"
 #include "../Util.h"
+#include "../SourceManager.h"
+#include "../DeclSplitter.h"
+#include "../IncrementalParser.h"
 #include "FormatContext.h"
 #include "FMNStatement.h"
 
@@ -25,11 +34,31 @@ using namespace boost::program_options;
 
 options_description progOpts;
 
+// with --lines, only the declarations overlapping these lines are formatted
+size_t firstLine = 0, lastLine = 0;
+
+/**
+ * The outcome of formatting a single file
+ */
+struct FormatResult
+{
+	path file;
+	string output;
+	string error;
+	bool changed = false;
+};
+
 void initOptions()
 {
 	progOpts.add_options()
 		("help", "produce help message")
-		("input", "input file");
+		("input", value<vector<string>>(), "input files or directories")
+		("in-place,i", "rewrite files that aren't formatted")
+		("check", "list files that aren't formatted and exit with an error")
+		("lines", value<string>(), "only format the declarations overlapping lines A:B")
+		("watch", "format the file again whenever it changes, parsing only the declarations that changed")
+		("jobs,j", value<int>(), "number of files to format in parallel (default: all cores)")
+		("lexer", value<string>(), "tokenizer to use: flex (default) or fast");
 }
 
 void loadOptions(int argc, char** argv, variables_map &vm)
@@ -41,15 +70,203 @@ void loadOptions(int argc, char** argv, variables_map &vm)
 	notify(vm);
 }
 
-int format(const path& file, NStatementList* statements, variables_map& vm)
+bool collectFiles(const vector<string>& inputs, vector<path>& files)
+{
+	for (auto& input : inputs) {
+		auto file = Util::relative(input);
+		if (is_directory(file)) {
+			vector<path> found;
+			for (recursive_directory_iterator it(file), end; it != end; ++it) {
+				if (is_regular_file(it->path()) && it->path().extension() == ".syp")
+					found.push_back(Util::relative(it->path()));
+			}
+			sort(found.begin(), found.end());
+			files.insert(files.end(), found.begin(), found.end());
+		} else if (exists(file)) {
+			files.push_back(file);
+		} else {
+			cout << "file not found: " << file << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+// writes through a temporary file so an interrupted run never truncates a source
+bool writeFile(const path& file, const string& data)
+{
+	auto tmp = file;
+	tmp += ".fmt" + to_string(getpid()) + "~";
+	boost::system::error_code err;
+	{
+		// closing flushes the buffer, which is when a full disk shows up
+		std::ofstream out(tmp.string(), ios::binary | ios::trunc);
+		out.write(data.data(), data.size());
+		out.close();
+		if (out.fail()) {
+			remove(tmp, err);
+			return false;
+		}
+	}
+	permissions(tmp, status(file).permissions(), err);
+	rename(tmp, file, err);
+	if (err) {
+		boost::system::error_code ignore;
+		remove(tmp, ignore);
+	}
+	return !err;
+}
+
+string formatError(Parser& parser)
 {
-	FormatContext context;
+	auto err = parser.getError();
+	return err.filename + ":" + to_string(err.line) + ": " + err.str;
+}
 
-	FMNStatement::run(context, statements);
+bool formatFile(FormatResult& result)
+{
+	Parser parser(result.file.string());
+	if (parser.parse()) {
+		result.error = formatError(parser);
+		return false;
+	}
 
+	ostringstream stream;
+	FormatContext context(stream);
+	FMNStatement::run(context, parser.getRoot());
 	context.print();
+	result.output = stream.str();
+	return true;
+}
+
+// re-emits the declarations overlapping the line range, copying the rest of the file as is
+bool formatLines(FormatResult& result, const SourceFile& source, const vector<DeclSpan>& spans)
+{
+	size_t done = 0;
+	for (auto& span : spans) {
+		if (span.endLine < firstLine)
+			continue;
+		else if (span.line > lastLine)
+			break;
+
+		auto parser = DeclSplitter::parser(result.file.string(), source, span);
+		if (parser->parse()) {
+			result.error = formatError(*parser);
+			return false;
+		}
+
+		ostringstream stream;
+		FormatContext context(stream);
+		FMNStatement::run(context, parser->getRoot());
+		context.print();
+
+		// declarations are written with surrounding blank lines
+		auto text = stream.str();
+		auto start = text.find_first_not_of('\n');
+		auto end = text.find_last_not_of('\n');
+		result.output.append(source.data() + done, span.offset - done);
+		if (start != string::npos)
+			result.output.append(text, start, end - start + 1);
+		done = span.offset + span.length;
+	}
+	result.output.append(source.data() + done, source.size() - done);
+	return true;
+}
+
+void format(FormatResult& result, bool keepOutput)
+{
+	auto filename = result.file.string();
+	auto source = SourceManager::get(filename);
+	bool valid = lastLine? formatLines(result, *source, DeclSplitter::split(filename, source)) : formatFile(result);
+
+	if (valid)
+		result.changed = result.output.compare(0, string::npos, source->data(), source->size()) != 0;
+	source.reset();
+	SourceManager::release(filename);
+
+	if (!keepOutput || !valid)
+		result.output.clear();
+}
+
+int formatAll(const vector<path>& files, variables_map& vm)
+{
+	bool inPlace = vm.count("in-place"), check = vm.count("check");
+	int jobs = vm.count("jobs")? vm["jobs"].as<int>() : thread::hardware_concurrency();
+	jobs = max(1, min<int>(jobs, files.size()));
+
+	vector<FormatResult> results(files.size());
+	for (size_t i = 0; i < files.size(); i++)
+		results[i].file = files[i];
+
+	atomic<size_t> next(0);
+	auto worker = [&](){
+		for (size_t i; (i = next++) < results.size();) {
+			auto& result = results[i];
+			format(result, inPlace || !check);
+			if (inPlace && result.changed && result.error.empty() && !writeFile(result.file, result.output))
+				result.error = "unable to write file: " + result.file.string();
+			if (inPlace)
+				result.output.clear();
+		}
+	};
+	vector<thread> workers;
+	for (int i = 1; i < jobs; i++)
+		workers.emplace_back(worker);
+	worker();
+	for (auto& w : workers)
+		w.join();
+
+	int ret = 0;
+	for (auto& result : results) {
+		if (!result.error.empty()) {
+			cout << result.error << endl;
+			ret = 1;
+		} else if (check) {
+			if (result.changed) {
+				cout << result.file.string() << endl;
+				ret = 1;
+			}
+		} else if (!inPlace) {
+			cout.write(result.output.data(), result.output.size());
+		}
+	}
+	cout.flush();
+	return ret;
+}
+
+int watch(const path& file, variables_map& vm)
+{
+	IncrementalParser parser(file.string());
+	while (true) {
+		boost::system::error_code err;
+		auto mtime = last_write_time(file, err);
+		auto size = file_size(file, err);
 
-	return 0;
+		if (parser.parse()) {
+			auto error = parser.getError();
+			cout << error.filename << ":" << error.line << ": " << error.str << endl;
+		} else {
+			ostringstream stream;
+			FormatContext context(stream);
+			FMNStatement::run(context, parser.getRoot());
+			context.print();
+			auto output = stream.str();
+
+			if (!vm.count("in-place")) {
+				cout.write(output.data(), output.size());
+				cout.flush();
+			} else {
+				auto source = SourceManager::get(file.string());
+				if (output.compare(0, string::npos, source->data(), source->size()) != 0) {
+					if (!writeFile(file, output))
+						cout << "unable to write file: " << file.string() << endl;
+				}
+			}
+		}
+
+		while (last_write_time(file, err) == mtime && file_size(file, err) == size)
+			this_thread::sleep_for(chrono::milliseconds(200));
+	}
 }
 
 int main(int argc, char** argv)
@@ -59,6 +276,12 @@ int main(int argc, char** argv)
 	initOptions();
 	loadOptions(argc, argv, vm);
 
+	auto lexer = vm.count("lexer")? vm["lexer"].as<string>() : "flex";
+	if (!Lexer::setDefault(lexer)) {
+		cout << "invalid lexer: " << lexer << endl;
+		return 1;
+	}
+
 	if (vm.count("help")) {
 		progOpts.print(cout);
 		return 0;
@@ -67,17 +290,27 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
-	auto file = Util::relative(vm["input"].as<string>());
-	if (!exists(file)) {
-		cout << "file not found: " << file << endl;
+	vector<path> files;
+	if (!collectFiles(vm["input"].as<vector<string>>(), files))
 		return 1;
-	}
 
-	Parser parser(file.string());
-	if (parser.parse()) {
-		auto err = parser.getError();
-		cout << err.filename << ":" << err.line << ": " << err.str << endl;
-		return 1;
+	if (vm.count("watch")) {
+		if (files.size() != 1 || vm.count("lines") || vm.count("check")) {
+			cout << "--watch requires a single input file and can't be used with --lines or --check" << endl;
+			return 1;
+		}
+		return watch(files[0], vm);
+	} else if (vm.count("lines")) {
+		auto range = vm["lines"].as<string>();
+		char sep = 0;
+		istringstream in(range);
+		if (!(in >> firstLine >> sep >> lastLine) || sep != ':' || !firstLine || firstLine > lastLine || !in.eof()) {
+			cout << "invalid line range: " << range << endl;
+			return 1;
+		} else if (files.size() != 1 || is_directory(Util::relative(vm["input"].as<vector<string>>()[0]))) {
+			cout << "--lines requires a single input file" << endl;
+			return 1;
+		}
 	}
-	return format(file, parser.getRoot(), vm);
+	return formatAll(files, vm);
 }
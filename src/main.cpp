@@ -15,12 +15,20 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <thread>
 #include "parser.h"
 #include "AST.h"
 #include "CodeContext.h"
 #include "CGNStatement.h"
 #include "CGNImportList.h"
+#include "Builder.h"
+#include "CompileCache.h"
+#include "CompileServer.h"
+#include "ImportCache.h"
+#include "IncrementalParser.h"
 #include "ModuleWriter.h"
+#include "PhaseTimer.h"
+#include "SourceManager.h"
 #include "Util.h"
 
 options_description progOpts;
@@ -31,45 +39,158 @@ void initOptions()
 		("help", "produce help message")
 		("input", "input file")
 		("llvmir", "output LLVM IR instead of object code")
+		("whole-program", "compile all imported files into one optimized module")
+		("optimize", "run the optimizer on the module (implied by whole-program)")
+		("stats", "print optimization statistics")
+		("jobs", value<int>(), "split native code generation across N threads (writes file.N.o)")
+		("cache-dir", value<string>(), "reuse outputs of unchanged compiles from the given directory")
+		("cache-size", value<int>(), "maximum size of the cache in MB (default 1024)")
+		("cache-stats", "print the cache hit/miss counts and exit")
+		("server", value<string>(), "run a compile server listening on the given unix socket")
+		("client", value<string>(), "send the compile to the server listening on the given unix socket")
+		("watch", "rebuild whenever the file changes, parsing only the declarations that changed")
+		("stream", "generate code for each declaration as it's parsed, freeing its AST afterwards")
+		("lexer", value<string>(), "tokenizer to use: flex (default) or fast")
+		("time-phases", value<string>(), "write the time of each compile phase as JSON to the given file (- for stdout)")
 		("imports", "output imports listed in the file");
 }
 
-void loadOptions(int argc, char** argv, variables_map &vm)
+void loadOptions(const vector<string>& args, variables_map &vm)
 {
 	positional_options_description fileOpt;
 	fileOpt.add("input", -1);
 
-	store(command_line_parser(argc, argv).options(progOpts).positional(fileOpt).run(), vm);
+	store(command_line_parser(args).options(progOpts).positional(fileOpt).run(), vm);
 	notify(vm);
 }
 
-int compile(const path& file, NStatementList* statements, variables_map& vm)
+vector<string> clientArgs(const vector<string>& args)
+{
+	vector<string> forward;
+	for (size_t i = 0; i < args.size(); i++) {
+		if (args[i] == "--client")
+			i++;
+		else if (args[i].compare(0, 9, "--client=") != 0)
+			forward.push_back(args[i]);
+	}
+	return forward;
+}
+
+unique_ptr<CompileCache> openCache(variables_map& vm)
+{
+	if (!vm.count("cache-dir"))
+		return nullptr;
+	uintmax_t size = vm.count("cache-size")? vm["cache-size"].as<int>() : 1024;
+	return unique_ptr<CompileCache>(new CompileCache(vm["cache-dir"].as<string>(), size << 20));
+}
+
+void printSyntaxError(Parser& parser)
+{
+	auto err = parser.getError();
+	cout << err.filename << ":" << err.line << ": " << err.str << endl;
+}
+
+int compile(const path& file, variables_map& vm, CompileCache* cache, ImportCache* imports, function<bool(CodeContext&)> generate)
 {
 	LLVMContext llvmContext;
 	unique_ptr<Module> module(new Module(file.string(), llvmContext));
 	CodeContext context(module.get());
 
+	context.setImportCache(imports);
+	context.setStreaming(vm.count("stream"));
 	context.pushFile(file);
-	CGNStatement::run(context, statements);
+	PhaseTimer::Scope phase("codegen");
+	if (!generate(context))
+		return 1;
+	Builder::DefineGenerics(context);
+	// with whole-program the constexpr functions of imports get bodies too
+	if (!vm.count("whole-program"))
+		Builder::DefineGlobals(context);
 	if (context.handleErrors())
 		return 2;
 
+	if (vm.count("whole-program")) {
+		Builder::DefineImports(context);
+		Builder::DefineGenerics(context);
+		Builder::DefineGlobals(context);
+		if (context.handleErrors())
+			return 2;
+	}
+
 	context.popFile();
 	ModuleWriter writer(*module.get(), file.string(), vm);
 
-	return writer.run();
+	auto ret = writer.run();
+	if (!ret && cache)
+		cache->store(context.getFiles());
+	if (!ret && vm.count("time-phases"))
+		PhaseTimer::report(vm["time-phases"].as<string>(), file.string(), context.getFiles());
+	return ret;
 }
 
-int main(int argc, char** argv)
+bool isClass(NStatement* stm)
+{
+	return stm->id() == NodeId::NClassDeclaration;
+}
+
+int watch(const path& file, variables_map& vm, CompileCache* cache)
+{
+	IncrementalParser parser(file.string());
+	ImportCache imports;
+	while (true) {
+		boost::system::error_code err;
+		auto mtime = last_write_time(file, err);
+		auto size = file_size(file, err);
+
+		// imports may have changed too
+		SourceManager::clear();
+		// each rebuild gets its own report, which ends the timing
+		if (vm.count("time-phases"))
+			PhaseTimer::enable();
+		auto failed = [&]{
+			PhaseTimer::Scope phase("parse");
+			return parser.parse();
+		}();
+		if (failed) {
+			auto error = parser.getError();
+			cout << error.filename << ":" << error.line << ": " << error.str << endl;
+		} else {
+			compile(file, vm, cache, &imports, [&](CodeContext& context){
+				CGNStatement::run(context, parser.getRoot());
+				return true;
+			});
+			// code generation adds the implicit members to classes
+			parser.invalidate(isClass);
+			cout << "built " << file.string() << ": parsed " << parser.parsed() << " of " << parser.size() << " declarations" << endl;
+		}
+
+		while (last_write_time(file, err) == mtime && file_size(file, err) == size)
+			this_thread::sleep_for(chrono::milliseconds(200));
+	}
+}
+
+int runCommand(const vector<string>& args, ImportCache* imports)
 {
 	variables_map vm;
+	loadOptions(args, vm);
 
-	initOptions();
-	loadOptions(argc, argv, vm);
+	auto lexer = vm.count("lexer")? vm["lexer"].as<string>() : "flex";
+	if (!Lexer::setDefault(lexer)) {
+		cout << "invalid lexer: " << lexer << endl;
+		return 1;
+	}
 
+	auto cache = openCache(vm);
 	if (vm.count("help")) {
 		progOpts.print(cout);
 		return 0;
+	} else if (vm.count("cache-stats")) {
+		if (!cache) {
+			cout << "cache-stats requires cache-dir" << endl;
+			return 1;
+		}
+		cache->printStats(cout);
+		return 0;
 	} else if (!vm.count("input")) {
 		cout << "no input file provided" << endl;
 		return 1;
@@ -81,14 +202,71 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
+	// source files stay mapped until the compile finishes
+	SourceManager::Scope sources;
+	if (vm.count("time-phases"))
+		PhaseTimer::enable();
+	if (vm.count("watch")) {
+		if (imports || vm.count("stream") || vm.count("imports")) {
+			cout << "watch can't be used with server, stream or imports" << endl;
+			return 1;
+		}
+		return watch(file, vm, cache.get());
+	}
+	if (cache && !vm.count("imports") && cache->restore(file, ModuleWriter::outputFiles(file.string(), vm), vm))
+		return 0;
+
 	Parser parser(file.string());
-	if (parser.parse()) {
-		auto err = parser.getError();
-		cout << err.filename << ":" << err.line << ": " << err.str << endl;
+	if (vm.count("stream") && !vm.count("imports")) {
+		return compile(file, vm, cache.get(), imports, [&](CodeContext& context){
+			parser.setDeclHandler([&](NStatement* stm){
+				PhaseTimer::Scope phase("codegen");
+				CGNStatement::run(context, stm);
+				if (!context.keepGeneric(stm))
+					delete stm;
+			});
+			PhaseTimer::Scope phase("parse");
+			if (parser.parse()) {
+				printSyntaxError(parser);
+				return false;
+			}
+			return true;
+		});
+	}
+
+	auto failed = [&]{
+		PhaseTimer::Scope phase("parse");
+		return parser.parse();
+	}();
+	if (failed) {
+		printSyntaxError(parser);
 		return 1;
 	} else if (vm.count("imports")) {
 		CGNImportList::run(parser.getRoot());
 		return 0;
 	}
-	return compile(file, parser.getRoot(), vm);
+	return compile(file, vm, cache.get(), imports, [&](CodeContext& context){
+		CGNStatement::run(context, parser.getRoot());
+		return true;
+	});
+}
+
+int main(int argc, char** argv)
+{
+	vector<string> args(argv + 1, argv + argc);
+	variables_map vm;
+
+	initOptions();
+	loadOptions(args, vm);
+
+	if (vm.count("server")) {
+		ImportCache imports;
+		CompileServer server(vm["server"].as<string>());
+		return server.run([&](const vector<string>& request){
+			return runCommand(request, &imports);
+		});
+	} else if (vm.count("client")) {
+		return CompileServer::forward(vm["client"].as<string>(), clientArgs(args));
+	}
+	return runCommand(args, nullptr);
 }
@@ -0,0 +1,141 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cerrno>
+#include <deque>
+#include <unordered_map>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "Runtime.h"
+
+using namespace std;
+
+namespace {
+
+// the start of every coroutine frame in LLVM's switched-resume lowering;
+// resume is cleared once the coroutine reaches its final suspend point
+struct CoroutineFrame
+{
+	void (*resume)(void*);
+	void (*destroy)(void*);
+};
+
+inline CoroutineFrame* frame(void* handle)
+{
+	return static_cast<CoroutineFrame*>(handle);
+}
+
+// single threaded: coroutines only run inside saphyr_run on the calling thread
+class EventLoop
+{
+	deque<void*> ready;
+	unordered_map<int32_t, void*> waiting;
+	void* current = nullptr;
+	bool parked = false;
+	int epollFd = -1;
+
+	void step(void* handle)
+	{
+		if (frame(handle)->resume) {
+			current = handle;
+			parked = false;
+			frame(handle)->resume(handle);
+			current = nullptr;
+		}
+		if (!frame(handle)->resume)
+			frame(handle)->destroy(handle);
+		else if (!parked)
+			ready.push_back(handle);
+	}
+
+	void poll()
+	{
+		epoll_event events[64];
+		auto count = epoll_wait(epollFd, events, 64, -1);
+		for (int i = 0; i < count; i++) {
+			auto fd = events[i].data.fd;
+			epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+			ready.push_back(waiting[fd]);
+			waiting.erase(fd);
+		}
+	}
+
+public:
+	~EventLoop()
+	{
+		if (epollFd >= 0)
+			close(epollFd);
+	}
+
+	void spawn(void* handle)
+	{
+		ready.push_back(handle);
+	}
+
+	void run()
+	{
+		while (!ready.empty() || !waiting.empty()) {
+			while (!ready.empty()) {
+				auto handle = ready.front();
+				ready.pop_front();
+				step(handle);
+			}
+			if (!waiting.empty())
+				poll();
+		}
+	}
+
+	int32_t wait(int32_t fd, int32_t events)
+	{
+		if (!current || waiting.count(fd))
+			return -1;
+		if (epollFd < 0 && (epollFd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+			return -1;
+
+		epoll_event event = {};
+		if (events & SAPHYR_READ)
+			event.events |= EPOLLIN;
+		if (events & SAPHYR_WRITE)
+			event.events |= EPOLLOUT;
+		event.data.fd = fd;
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+			return -1;
+
+		waiting[fd] = current;
+		parked = true;
+		return 0;
+	}
+};
+
+EventLoop loop;
+
+}
+
+extern "C" void saphyr_spawn(void* handle)
+{
+	loop.spawn(handle);
+}
+
+extern "C" void saphyr_run()
+{
+	loop.run();
+}
+
+extern "C" int32_t saphyr_wait_fd(int32_t fd, int32_t events)
+{
+	return loop.wait(fd, events);
+}
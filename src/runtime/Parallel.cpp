@@ -0,0 +1,226 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Runtime.h"
+
+using namespace std;
+
+namespace {
+
+// both ends are inclusive so a range can end at the type's max
+struct Range
+{
+	uint64_t first;
+	uint64_t last;
+};
+
+// chunks owned by one thread; the owner takes from the back and
+// idle threads steal from the front
+class WorkQueue
+{
+	mutex lock;
+	deque<Range> ranges;
+
+public:
+	void push(Range range)
+	{
+		lock_guard<mutex> guard(lock);
+		ranges.push_back(range);
+	}
+
+	bool pop(Range& range)
+	{
+		lock_guard<mutex> guard(lock);
+		if (ranges.empty())
+			return false;
+		range = ranges.back();
+		ranges.pop_back();
+		return true;
+	}
+
+	bool steal(Range& range)
+	{
+		lock_guard<mutex> guard(lock);
+		if (ranges.empty())
+			return false;
+		range = ranges.front();
+		ranges.pop_front();
+		return true;
+	}
+};
+
+thread_local bool inPool = false;
+
+class ThreadPool
+{
+	vector<thread> workers;
+	vector<unique_ptr<WorkQueue>> queues;
+
+	// only one loop runs on the pool at a time
+	mutex loopLock;
+
+	mutex stateLock;
+	condition_variable wake;
+	condition_variable done;
+	uint64_t generation = 0;
+	bool stopping = false;
+
+	SaphyrLoopBody body = nullptr;
+	void* env = nullptr;
+	atomic<int64_t> remaining;
+
+	bool findWork(size_t self, Range& range)
+	{
+		if (queues[self]->pop(range))
+			return true;
+		for (size_t i = 1; i < queues.size(); i++) {
+			if (queues[(self + i) % queues.size()]->steal(range))
+				return true;
+		}
+		return false;
+	}
+
+	void runChunks(size_t self)
+	{
+		Range range;
+		while (findWork(self, range)) {
+			body(env, range.first, range.last);
+			if (remaining.fetch_sub(1) == 1) {
+				lock_guard<mutex> guard(stateLock);
+				done.notify_all();
+			}
+		}
+	}
+
+	void worker(size_t self)
+	{
+		inPool = true;
+		uint64_t seen = 0;
+		while (true) {
+			{
+				unique_lock<mutex> guard(stateLock);
+				wake.wait(guard, [&]{ return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+			}
+			runChunks(self);
+		}
+	}
+
+public:
+	ThreadPool()
+	: remaining(0)
+	{
+		auto count = thread::hardware_concurrency();
+		auto threads = getenv("SAPHYR_THREADS");
+		if (threads && atoi(threads) > 0)
+			count = atoi(threads);
+		if (!count)
+			count = 1;
+
+		// the calling thread uses queue 0
+		for (size_t i = 0; i < count; i++)
+			queues.push_back(unique_ptr<WorkQueue>(new WorkQueue));
+		for (size_t i = 1; i < count; i++)
+			workers.push_back(thread(&ThreadPool::worker, this, i));
+	}
+
+	~ThreadPool()
+	{
+		{
+			lock_guard<mutex> guard(stateLock);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (auto& item : workers)
+			item.join();
+	}
+
+	void run(SaphyrLoopBody loopBody, void* loopEnv, Range range, uint64_t chunk)
+	{
+		lock_guard<mutex> loopGuard(loopLock);
+		inPool = true;
+
+		// one less than the iteration count, which always fits
+		uint64_t span = range.last - range.first;
+		if (!chunk)
+			chunk = max<uint64_t>(1, span / (queues.size() * 4));
+
+		body = loopBody;
+		env = loopEnv;
+		remaining = span / chunk + 1;
+
+		// deal the chunks out round-robin so each thread starts with local work;
+		// offsets stay within span so stepping can't overflow
+		size_t idx = 0;
+		for (uint64_t offset = 0;; offset += chunk, idx++) {
+			auto left = span - offset;
+			auto last = left < chunk? span : offset + chunk - 1;
+			queues[idx % queues.size()]->push({range.first + offset, range.first + last});
+			if (left < chunk)
+				break;
+		}
+
+		{
+			lock_guard<mutex> guard(stateLock);
+			generation++;
+		}
+		wake.notify_all();
+
+		runChunks(0);
+
+		// join barrier: wait for chunks still running on other threads
+		unique_lock<mutex> guard(stateLock);
+		done.wait(guard, [&]{ return remaining == 0; });
+		inPool = false;
+	}
+};
+
+}
+
+extern "C" void saphyr_parallel_for(SaphyrLoopBody body, void* env, int64_t begin, int64_t end, int64_t chunk, int32_t flags)
+{
+	bool isEmpty;
+	if (flags & SAPHYR_RANGE_UNSIGNED)
+		isEmpty = (flags & SAPHYR_RANGE_INCLUSIVE)? uint64_t(begin) > uint64_t(end) : uint64_t(begin) >= uint64_t(end);
+	else
+		isEmpty = (flags & SAPHYR_RANGE_INCLUSIVE)? begin > end : begin >= end;
+	if (isEmpty)
+		return;
+
+	Range range = {uint64_t(begin), uint64_t(end)};
+	if (!(flags & SAPHYR_RANGE_INCLUSIVE))
+		range.last--;
+
+	// nested parallel loops run on the current thread
+	if (inPool) {
+		body(env, range.first, range.last);
+		return;
+	}
+
+	static ThreadPool pool;
+	pool.run(body, env, range, chunk > 0? chunk : 0);
+}
@@ -0,0 +1,62 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2018, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __RUNTIME_H__
+#define __RUNTIME_H__
+
+#include <cstdint>
+
+// functions called by code the compiler generates; link with libsyrt.a
+
+extern "C" {
+
+typedef void (*SaphyrLoopBody)(void* env, int64_t first, int64_t last);
+
+enum { SAPHYR_RANGE_INCLUSIVE = 1, SAPHYR_RANGE_UNSIGNED = 2 };
+
+/*
+ * Runs body over [begin, end), or [begin, end] with SAPHYR_RANGE_INCLUSIVE,
+ * split into chunks on the runtime's thread pool and returns once every
+ * chunk has finished. Each chunk is passed as its first and last value.
+ * SAPHYR_RANGE_UNSIGNED compares the bounds as uint64. A chunk size of 0
+ * picks one based on the number of threads. SAPHYR_THREADS sets the pool size.
+ */
+void saphyr_parallel_for(SaphyrLoopBody body, void* env, int64_t begin, int64_t end, int64_t chunk, int32_t flags);
+
+enum { SAPHYR_READ = 1, SAPHYR_WRITE = 2 };
+
+/*
+ * Queues the coroutine handle returned by an async function. The event loop
+ * destroys it once it finishes.
+ */
+void saphyr_spawn(void* handle);
+
+/*
+ * Resumes queued coroutines until all have finished. A coroutine that
+ * yields is queued again, unless it's waiting on a file descriptor.
+ */
+void saphyr_run();
+
+/*
+ * Called by the running coroutine before it yields so it's only resumed
+ * once fd is readable or writable (SAPHYR_READ | SAPHYR_WRITE). Returns -1
+ * outside of saphyr_run or if fd already has a waiter.
+ */
+int32_t saphyr_wait_fd(int32_t fd, int32_t events);
+
+}
+
+#endif